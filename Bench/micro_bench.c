@@ -0,0 +1,500 @@
+/*
+ *	micro_bench.c
+ *
+ *	Microbenchmarks of the drawing and simulation code the game runs on
+ *	every frame:
+ *
+ *	-	sprite_draw of the player and of a radius 15 boss.
+ *	-	draw_line across the screen: horizontal, vertical and diagonal.
+ *	-	draw_formatted of a HUD line.
+ *	-	create_bitmap of a boss image, radii 5 to 15 (interned and released).
+ *	-	hit_top_platform and hit_side_platform at 25, 1000 and 100000 platforms.
+ *	-	process_platform, with the platforms recycled, at the same sizes.
+ *	-	draw_all: a whole frame of a level 3 game, play area and HUD, drawn
+ *		by the game's draw_game (game_view.h) and shown on the override screen.
+ *	-	frame_timing: the timing of one pass of the event loop, as the game
+ *		does with its overlay off (frame_stats.h).
+ *
+ *	Each benchmark is run until a pass takes at least MIN_PASS_NS, to find
+ *	the number of operations per pass, and then timed over PASSES passes.
+ *	The fastest pass is reported, in nanoseconds per operation, as the one
+ *	least disturbed by the rest of the machine. Layouts, player positions
+ *	and games all come from fixed seeds, and with a baseline the number of
+ *	operations per pass is taken from it, so runs measure the same work.
+ *
+ *	Results are written as JSON, one benchmark per line. Given a baseline
+ *	(an earlier output file), each result also carries the baseline time
+ *	and the change from it in percent, and is marked as regressed if it is
+ *	more than the threshold slower.
+ *
+ *	Usage: micro_bench [--output file] [--baseline file] [--threshold percent]
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "cab202_graphics.h"
+#include "cab202_timers.h"
+#include "cab202_sprites.h"
+#include "cab202_bitmap_atlas.h"
+#include "player.h"
+#include "boss_sprite.h"
+#include "session.h"
+#include "frame_stats.h"
+#include "game_view.h"
+
+#define SCREEN_WIDTH 80
+#define SCREEN_HEIGHT 50
+
+#define PASSES 7
+#define MIN_PASS_NS 20000000
+#define MAX_RESULTS 64
+#define NAME_SIZE 64
+#define POSITIONS 4096 // player positions cycled through by the collision tests
+#define DEFAULT_THRESHOLD 10.0
+
+/*
+ *	A benchmark runs ops operations on its context, and returns the time they took.
+ */
+typedef timer_ns ( *bench_function )( void * context, long ops );
+
+typedef struct bench_result {
+	char name[NAME_SIZE];
+	double ns_per_op;
+	long ops; // operations per pass
+} bench_result;
+
+static bench_result results[MAX_RESULTS];
+static int result_count = 0;
+
+static volatile long sink; // keeps the timed loops from being optimised away
+
+static FILE * baseline = NULL; // results of an earlier run, if given
+
+/*
+ *	Looks up name in the baseline, as written by write_results. Returns false
+ *	if it is not there, or else sets *ns_per_op and *ops from it.
+ */
+static bool baseline_result( const char * name, double * ns_per_op, long * ops ) {
+	char line[256];
+	char found[NAME_SIZE];
+
+	if ( baseline == NULL ) return false;
+
+	rewind( baseline );
+
+	while ( fgets( line, sizeof( line ), baseline ) != NULL ) {
+		char * entry = strstr( line, "\"name\":" );
+
+		if ( entry != NULL
+			&& sscanf( entry, "\"name\": \"%63[^\"]\", \"ns_per_op\": %lf, \"ops\": %ld", found, ns_per_op, ops ) == 3
+			&& strcmp( found, name ) == 0 ) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ *	Times run on context, and records the result under name.
+ */
+static void measure( const char * name, bench_function run, void * context ) {
+	double base_ns;
+	long ops = 1;
+
+	if ( baseline_result( name, &base_ns, &ops ) && ops > 0 ) {
+		run( context, ops ); // warms up
+	} else {
+		ops = 1;
+
+		while ( run( context, ops ) < MIN_PASS_NS / 8 ) ops *= 2; // also warms up
+
+		while ( run( context, ops ) < MIN_PASS_NS ) ops *= 2;
+	}
+
+	timer_ns best_ns = run( context, ops );
+
+	for ( int p = 1; p < PASSES; p++ ) {
+		timer_ns ns = run( context, ops );
+
+		if ( ns < best_ns ) best_ns = ns;
+	}
+
+	if ( result_count < MAX_RESULTS ) {
+		bench_result * r = &results[result_count++];
+		snprintf( r->name, NAME_SIZE, "%s", name );
+		r->ns_per_op = (double) best_ns / ops;
+		r->ops = ops;
+	}
+
+	printf( "%-28s %12.1f ns/op\n", name, (double) best_ns / ops );
+	fflush( stdout );
+}
+
+// ----------------------------------------------------------------
+// Drawing
+// ----------------------------------------------------------------
+
+static timer_ns bench_sprite_draw( void * context, long ops ) {
+	sprite_id sprite = context;
+	timer_ns start = get_host_ns();
+
+	for ( long i = 0; i < ops; i++ ) {
+		sprite_draw( sprite );
+	}
+
+	return get_host_ns() - start;
+}
+
+static timer_ns bench_hline( void * context, long ops ) {
+	timer_ns start = get_host_ns();
+
+	for ( long i = 0; i < ops; i++ ) {
+		int y = i % SCREEN_HEIGHT;
+		draw_line( 0, y, SCREEN_WIDTH - 1, y, '-' );
+	}
+
+	return get_host_ns() - start;
+}
+
+static timer_ns bench_vline( void * context, long ops ) {
+	timer_ns start = get_host_ns();
+
+	for ( long i = 0; i < ops; i++ ) {
+		int x = i % SCREEN_WIDTH;
+		draw_line( x, 0, x, SCREEN_HEIGHT - 1, '|' );
+	}
+
+	return get_host_ns() - start;
+}
+
+static timer_ns bench_diagonal( void * context, long ops ) {
+	timer_ns start = get_host_ns();
+
+	for ( long i = 0; i < ops; i++ ) {
+		if ( i & 1 ) {
+			draw_line( 0, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1, '\\' );
+		} else {
+			draw_line( 0, SCREEN_HEIGHT - 1, SCREEN_WIDTH - 1, 0, '/' );
+		}
+	}
+
+	return get_host_ns() - start;
+}
+
+static timer_ns bench_draw_formatted( void * context, long ops ) {
+	timer_ns start = get_host_ns();
+
+	for ( long i = 0; i < ops; i++ ) {
+		draw_formatted( 0, 0, "Score: %d  Lives: %d  Level: %d  Time: %02d:%02d",
+			(int) ( i & 1023 ), 3, 2, (int) ( i / 60 % 60 ), (int) ( i % 60 ) );
+	}
+
+	return get_host_ns() - start;
+}
+
+static timer_ns bench_create_bitmap( void * context, long ops ) {
+	int radius = *(int *) context;
+	timer_ns start = get_host_ns();
+
+	for ( long i = 0; i < ops; i++ ) {
+		bitmap_release( create_bitmap( radius, '>' ) ); // nothing else holds it, so it is freed
+	}
+
+	return get_host_ns() - start;
+}
+
+// ----------------------------------------------------------------
+// Platforms
+// ----------------------------------------------------------------
+
+typedef struct platform_context {
+	platform_store store;
+	platform_grid grid;
+	platform_ring ring;
+	game_rng rng;
+	player_id player;
+	num xs[POSITIONS]; // player positions, each near a platform
+	num ys[POSITIONS];
+} platform_context;
+
+/*
+ *	Sets up an endless level 1 layout of count platforms, and player positions near them.
+ */
+static platform_context * platform_context_create( int count ) {
+	platform_context * c = calloc( 1, sizeof( platform_context ) );
+
+	if ( c == NULL || !platform_store_init( &c->store, count ) || !grid_init( &c->grid, count ) ) {
+		fprintf( stderr, "Unable to allocate %d platforms\n", count );
+		exit( 1 );
+	}
+
+	rng_seed( &c->rng, 1 );
+	setup_platform( &c->store, 1, &c->rng );
+	grid_build( &c->grid, &c->store );
+	setup_ring( &c->ring, count );
+
+	for ( int t = 0; t < POSITIONS; t++ ) {
+		int near = rand_between( &c->rng, 0, count - 1 );
+		c->xs[t] = c->store.x[near] + NUM_INT( rand_between( &c->rng, -2, c->store.width[near] + 1 ) );
+		c->ys[t] = c->store.y[near] - NUM_INT( 3 ) + num_mul( NUM_INT( rand_between( &c->rng, 0, 399 ) ), NUM( 0.01 ) );
+	}
+
+	return c;
+}
+
+static void platform_context_free( platform_context * c ) {
+	grid_release( &c->grid );
+	platform_store_release( &c->store );
+	free( c );
+}
+
+static timer_ns bench_hit_top( void * context, long ops ) {
+	platform_context * c = context;
+	long sum = 0;
+	timer_ns start = get_host_ns();
+
+	for ( long i = 0; i < ops; i++ ) {
+		c->player.body.x = c->xs[i % POSITIONS];
+		c->player.body.y = c->ys[i % POSITIONS];
+		sum += hit_top_platform( &c->grid, &c->player );
+	}
+
+	timer_ns ns = get_host_ns() - start;
+	sink = sum;
+	return ns;
+}
+
+static timer_ns bench_hit_side( void * context, long ops ) {
+	platform_context * c = context;
+	long sum = 0;
+	timer_ns start = get_host_ns();
+
+	for ( long i = 0; i < ops; i++ ) {
+		c->player.body.x = c->xs[i % POSITIONS];
+		c->player.body.y = c->ys[i % POSITIONS];
+		sum += hit_side_platform( &c->grid, &c->player );
+	}
+
+	timer_ns ns = get_host_ns() - start;
+	sink = sum;
+	return ns;
+}
+
+/*
+ *	One step of the platforms at level 3, as in session_step: moved, then recycled.
+ */
+static timer_ns bench_process_platform( void * context, long ops ) {
+	platform_context * c = context;
+	long sum = 0;
+	timer_ns start = get_host_ns();
+
+	for ( long i = 0; i < ops; i++ ) {
+		sum += process_platform( &c->store, 3, NORMAL, &c->grid );
+		recycle_platforms( &c->ring, &c->store, &c->grid, &c->rng );
+	}
+
+	timer_ns ns = get_host_ns() - start;
+	sink = sum;
+	return ns;
+}
+
+// ----------------------------------------------------------------
+// Whole frames
+// ----------------------------------------------------------------
+
+typedef struct frame_context {
+	game_session * session;
+	game_view view;
+} frame_context;
+
+/*
+ *	Steps a level 3 game, jumping every second, and draws each step as main.c's
+ *	draw_all does. Only the drawing is timed.
+ */
+static timer_ns bench_draw_all( void * context, long ops ) {
+	frame_context * c = context;
+	timer_ns ns = 0;
+
+	for ( long i = 0; i < ops; i++ ) {
+		session_step( c->session, ( i % 40 == 0 ) ? KEY_UP : ERR );
+
+		if ( !c->session->player.player_sprite->is_visible ) {
+			session_setup_round( c->session );
+			setup_view( &c->view, screen_width() - 1, screen_height() - 1 );
+		}
+
+		timer_ns start = get_host_ns();
+		draw_game( &c->view, c->session );
+		show_screen();
+		ns += get_host_ns() - start;
+	}
+
+	return ns;
+}
+
+/*
+ *	Times a pass of the event loop with nothing in it: the cost of timing it.
+ */
+static timer_ns bench_frame_timing( void * context, long ops ) {
+	frame_stats * stats = context;
+	timer_ns start = get_host_ns();
+
+	for ( long i = 0; i < ops; i++ ) {
+		frame_begin( stats );
+		frame_lap( stats, PHASE_INPUT );
+		frame_lap( stats, PHASE_SIMULATION );
+		frame_lap( stats, PHASE_DRAW );
+		frame_lap( stats, PHASE_REFRESH );
+		frame_end( stats, 0 );
+	}
+
+	return get_host_ns() - start;
+}
+
+// ----------------------------------------------------------------
+// Results
+// ----------------------------------------------------------------
+
+/*
+ *	Writes the results as JSON, compared with the baseline if there is one.
+ *	Returns the number of regressions.
+ */
+static int write_results( FILE * f, double threshold ) {
+	int regressions = 0;
+
+	fprintf( f, "{\n" );
+	fprintf( f, "  \"screen\": [%d, %d],\n", SCREEN_WIDTH, SCREEN_HEIGHT );
+	fprintf( f, "  \"passes\": %d,\n", PASSES );
+	fprintf( f, "  \"threshold_pct\": %.1f,\n", threshold );
+	fprintf( f, "  \"benchmarks\": [\n" );
+
+	for ( int i = 0; i < result_count; i++ ) {
+		bench_result * r = &results[i];
+		double base;
+		long base_ops;
+
+		fprintf( f, "    { \"name\": \"%s\", \"ns_per_op\": %.2f, \"ops\": %ld", r->name, r->ns_per_op, r->ops );
+
+		if ( baseline_result( r->name, &base, &base_ops ) && base > 0 ) {
+			double change = ( r->ns_per_op - base ) * 100 / base;
+			bool regressed = change > threshold;
+			regressions += regressed;
+			fprintf( f, ", \"baseline_ns\": %.2f, \"change_pct\": %.1f, \"regressed\": %s",
+				base, change, regressed ? "true" : "false" );
+		}
+
+		fprintf( f, " }%s\n", i + 1 < result_count ? "," : "" );
+	}
+
+	fprintf( f, "  ],\n" );
+	fprintf( f, "  \"regressions\": %d\n", regressions );
+	fprintf( f, "}\n" );
+
+	return regressions;
+}
+
+int main( int argc, char * argv[] ) {
+	const char * output_name = NULL;
+	const char * baseline_name = NULL;
+	double threshold = DEFAULT_THRESHOLD;
+
+	for ( int i = 1; i < argc; i++ ) {
+		if ( strcmp( argv[i], "--output" ) == 0 && i + 1 < argc ) {
+			output_name = argv[++i];
+		} else if ( strcmp( argv[i], "--baseline" ) == 0 && i + 1 < argc ) {
+			baseline_name = argv[++i];
+		} else if ( strcmp( argv[i], "--threshold" ) == 0 && i + 1 < argc ) {
+			threshold = atof( argv[++i] );
+		} else {
+			fprintf( stderr, "Usage: %s [--output file] [--baseline file] [--threshold percent]\n", argv[0] );
+			return 1;
+		}
+	}
+
+	if ( baseline_name != NULL && ( baseline = fopen( baseline_name, "r" ) ) == NULL ) {
+		fprintf( stderr, "Unable to read baseline %s\n", baseline_name );
+		return 1;
+	}
+
+	override_screen_size( SCREEN_WIDTH, SCREEN_HEIGHT );
+	setup_screen();
+
+	// Sprites, from a game set up at level 3, where the boss is out.
+	game_session * game = malloc( sizeof( game_session ) );
+
+	if ( game == NULL || !session_init( game, 1 ) ) {
+		fprintf( stderr, "Unable to allocate the game\n" );
+		return 1;
+	}
+
+	game->level = 3;
+	session_setup_round( game );
+
+	sprite_id boss = sprite_create( 10, 10, 30, 30, " " );
+	bitmap_id boss_image = create_bitmap( 15, '>' );
+	sprite_set_bitmap( boss, boss_image );
+
+	measure( "sprite_draw/player", bench_sprite_draw, game->player.player_sprite );
+	measure( "sprite_draw/boss15", bench_sprite_draw, boss );
+	measure( "draw_line/horizontal", bench_hline, NULL );
+	measure( "draw_line/vertical", bench_vline, NULL );
+	measure( "draw_line/diagonal", bench_diagonal, NULL );
+	measure( "draw_formatted", bench_draw_formatted, NULL );
+
+	for ( int radius = 5; radius <= 15; radius++ ) {
+		char name[NAME_SIZE];
+		snprintf( name, NAME_SIZE, "create_bitmap/r%d", radius );
+		measure( name, bench_create_bitmap, &radius );
+	}
+
+	static const int counts[] = { 25, 1000, 100000 };
+
+	for ( int i = 0; i < (int) ( sizeof( counts ) / sizeof( counts[0] ) ); i++ ) {
+		char name[NAME_SIZE];
+		platform_context * c = platform_context_create( counts[i] );
+
+		snprintf( name, NAME_SIZE, "hit_top_platform/%d", counts[i] );
+		measure( name, bench_hit_top, c );
+		snprintf( name, NAME_SIZE, "hit_side_platform/%d", counts[i] );
+		measure( name, bench_hit_side, c );
+		snprintf( name, NAME_SIZE, "process_platform/%d", counts[i] );
+		measure( name, bench_process_platform, c );
+
+		platform_context_free( c );
+	}
+
+	static frame_context frame_game;
+	frame_game.session = game;
+	setup_view( &frame_game.view, screen_width() - 1, screen_height() - 1 );
+	measure( "draw_all", bench_draw_all, &frame_game );
+
+	static frame_stats frame;
+	frame_stats_init( &frame, 25 );
+	measure( "frame_timing", bench_frame_timing, &frame );
+
+	sprite_destroy( boss );
+	bitmap_release( boss_image );
+	session_release( game );
+	free( game );
+	cleanup_screen();
+
+	FILE * output = ( output_name != NULL ) ? fopen( output_name, "w" ) : stdout;
+
+	if ( output == NULL ) {
+		fprintf( stderr, "Unable to write %s\n", output_name );
+		return 1;
+	}
+
+	int regressions = write_results( output, threshold );
+
+	if ( output != stdout ) fclose( output );
+	if ( baseline != NULL ) fclose( baseline );
+
+	if ( baseline != NULL ) {
+		printf( "%d of %d benchmarks more than %.1f%% slower than %s\n", regressions, result_count, threshold, baseline_name );
+	}
+
+	return 0;
+}
@@ -0,0 +1,210 @@
+/*
+ *	platform_bench.c
+ *
+ *	Times the player's platform collision tests, as run on each tick of
+ *	level 1 (hit_top_platform and two hit_side_platform calls), against
+ *	endless layouts of increasing size:
+ *
+ *	-	"linear": every platform checked, as the tests used to do.
+ *	-	"grid": the spatial index of the game (platform_grid in platforms.h).
+ *
+ *	The player is placed near a random platform on each tick, so most tests
+ *	find something. The two methods must agree on every answer.
+ *
+ *	It then times moving the same layouts up the screen at level 3 speed:
+ *
+ *	-	"struct": one struct per platform, each moved and checked in turn,
+ *		as process_platform used to do.
+ *	-	"store": platform_step_all over the arrays of the platform store.
+ *
+ *	Both must leave every platform in the same place.
+ *
+ *	Usage: platform_bench [ticks]
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include "cab202_graphics.h"
+#include "cab202_timers.h"
+#include "cab202_sprites.h"
+#include "cab202_bitmap_atlas.h"
+#include "player.h"
+
+#define SCREEN_WIDTH 80
+#define SCREEN_HEIGHT 50
+#define SPEED 100
+
+typedef struct struct_platform {
+	num x, y, dy;
+	bool safe, is_visible;
+	int width;
+} struct_platform;
+
+static int linear_hit_top( platform_store * store, num x, num y ) {
+	for ( int i = 0; i < store->count; i++ ) {
+		if ( touches_top( store, i, x, y ) ) return i;
+	}
+
+	return -1;
+}
+
+static bool linear_hit_side( platform_store * store, num x, num y ) {
+	for ( int i = 0; i < store->count; i++ ) {
+		if ( touches_side( store, i, x, y ) ) return true;
+	}
+
+	return false;
+}
+
+static bool struct_step_all( struct_platform * plat, int n, int speed ) {
+	bool moved = false;
+
+	for ( int i = 0; i < n; i++ ) {
+		if ( plat[i].is_visible ) {
+			int y0 = num_round( plat[i].y );
+			plat[i].y += num_mul( plat[i].dy * speed, NUM( SPEED_MULTIPLIER ) );
+
+			if ( plat[i].y < NUM_INT( -3 ) ) {
+				plat[i].is_visible = false;
+			}
+
+			moved = moved || num_round( plat[i].y ) != y0;
+		}
+	}
+
+	return moved;
+}
+
+int main( int argc, char * argv[] ) {
+	int ticks = argc > 1 ? atoi( argv[1] ) : 2000;
+
+	if ( ticks <= 0 ) {
+		fprintf( stderr, "Usage: %s [ticks]\n", argv[0] );
+		return 1;
+	}
+
+	static const int counts[] = { 25, 250, 2500, 25000, 100000 };
+	double step_ns[2][sizeof( counts ) / sizeof( counts[0] )];
+
+	override_screen_size( SCREEN_WIDTH, SCREEN_HEIGHT );
+	srand( 1 );
+
+	num * xs = malloc( ticks * sizeof( num ) );
+	num * ys = malloc( ticks * sizeof( num ) );
+
+	printf( "%d ticks of 1 top and 2 side tests\n", ticks );
+	printf( "%9s %16s %16s %8s\n", "platforms", "linear ns/tick", "grid ns/tick", "hits" );
+
+	for ( int c = 0; c < (int) ( sizeof( counts ) / sizeof( counts[0] ) ); c++ ) {
+		int n = counts[c];
+		platform_store store;
+		platform_grid grid;
+		game_rng rng;
+
+		platform_store_init( &store, n );
+		rng_seed( &rng, 1 );
+		setup_platform( &store, 1, &rng );
+		grid_init( &grid, n );
+		grid_build( &grid, &store );
+
+		for ( int t = 0; t < ticks; t++ ) {
+			int near = rand() % n;
+			xs[t] = store.x[near] + NUM_INT( rand() % ( store.width[near] + 4 ) - 2 );
+			ys[t] = store.y[near] - NUM_INT( 3 ) + num_mul( NUM_INT( rand() % 400 ), NUM( 0.01 ) );
+		}
+
+		long long linear_sum = 0, grid_sum = 0;
+		player_id player;
+		memset( &player, 0, sizeof( player ) );
+
+		timer_ns start = get_monotonic_ns();
+
+		for ( int t = 0; t < ticks; t++ ) {
+			linear_sum += linear_hit_top( &store, xs[t], ys[t] ) + 1;
+			linear_sum += linear_hit_side( &store, xs[t], ys[t] );
+			linear_sum += linear_hit_side( &store, xs[t], ys[t] );
+		}
+
+		timer_ns linear_ns = get_monotonic_ns() - start;
+		start = get_monotonic_ns();
+
+		for ( int t = 0; t < ticks; t++ ) {
+			player.body.x = xs[t];
+			player.body.y = ys[t];
+			grid_sum += hit_top_platform( &grid, &player ) + 1;
+			grid_sum += hit_side_platform( &grid, &player );
+			grid_sum += hit_side_platform( &grid, &player );
+		}
+
+		timer_ns grid_ns = get_monotonic_ns() - start;
+
+		int hits = 0;
+
+		for ( int t = 0; t < ticks; t++ ) {
+			player.body.x = xs[t];
+			player.body.y = ys[t];
+			int top = linear_hit_top( &store, xs[t], ys[t] );
+
+			if ( top != hit_top_platform( &grid, &player )
+				|| linear_hit_side( &store, xs[t], ys[t] ) != hit_side_platform( &grid, &player ) ) {
+				fprintf( stderr, "Results differ with %d platforms\n", n );
+				return 1;
+			}
+
+			hits += top >= 0;
+		}
+
+		if ( linear_sum != grid_sum ) return 1; // keeps the timed loops from being optimised away
+
+		printf( "%9d %16.1f %16.1f %8d\n", n, (double) linear_ns / ticks, (double) grid_ns / ticks, hits );
+
+		// The same layout, moved both ways.
+		struct_platform * plat = malloc( n * sizeof( struct_platform ) );
+
+		for ( int i = 0; i < n; i++ ) {
+			plat[i] = (struct_platform) { store.x[i], store.y[i], store.dy[i], store.safe[i], store.is_visible[i], store.width[i] };
+		}
+
+		int struct_moves = 0, store_moves = 0;
+		start = get_monotonic_ns();
+
+		for ( int t = 0; t < ticks; t++ ) {
+			struct_moves += struct_step_all( plat, n, SPEED );
+		}
+
+		step_ns[0][c] = (double) ( get_monotonic_ns() - start ) / ticks;
+		start = get_monotonic_ns();
+
+		for ( int t = 0; t < ticks; t++ ) {
+			store_moves += platform_step_all( &store, 0, SPEED );
+		}
+
+		step_ns[1][c] = (double) ( get_monotonic_ns() - start ) / ticks;
+
+		for ( int i = 0; i < n; i++ ) {
+			if ( plat[i].y != store.y[i] || plat[i].is_visible != store.is_visible[i] ) {
+				fprintf( stderr, "Platform %d of %d ended up in different places\n", i, n );
+				return 1;
+			}
+		}
+
+		if ( struct_moves > ticks || store_moves > ticks ) return 1; // keeps the timed loops from being optimised away
+
+		free( plat );
+		grid_release( &grid );
+		platform_store_release( &store );
+	}
+
+	printf( "\n%d ticks of moving every platform\n", ticks );
+	printf( "%9s %16s %16s\n", "platforms", "struct ns/tick", "store ns/tick" );
+
+	for ( int c = 0; c < (int) ( sizeof( counts ) / sizeof( counts[0] ) ); c++ ) {
+		printf( "%9d %16.1f %16.1f\n", counts[c], step_ns[0][c], step_ns[1][c] );
+	}
+
+	free( xs );
+	free( ys );
+	return 0;
+}
@@ -0,0 +1,216 @@
+/*
+ *	screen_bench.c
+ *
+ *	Measures what it costs to put frames on a terminal with a ZDK display
+ *	backend. The same program is linked once against each terminal library
+ *	(libzdk.a for ncurses, libzdk_ansi.a for direct ANSI output) and the
+ *	results compared.
+ *
+ *	The program runs itself on a pseudo-terminal sized like the game's
+ *	screen. The child draws a scripted scene resembling the game (scrolling
+ *	platforms, a few moving sprites and a status line) and times each frame;
+ *	the parent plays the terminal, reading and counting every byte. Calls
+ *	to write(2) are counted by interposing write, which both ncurses and
+ *	the ANSI backend use for terminal output.
+ *
+ *	Usage: screen_bench_BACKEND [frames]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pty.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include "cab202_graphics.h"
+
+#ifndef BENCH_BACKEND
+#define BENCH_BACKEND "unknown"
+#endif
+
+#define BENCH_WIDTH 70
+#define BENCH_HEIGHT 55
+#define DEFAULT_FRAMES 2000
+
+#define NO_PLATFORMS 12
+#define NO_SPRITES 4
+
+/*
+ *	Results sent from the child to the parent.
+ */
+typedef struct Bench_Result {
+	long frames;
+	long writes;
+	long bytes;
+	double seconds;
+	double worst_seconds;
+} Bench_Result;
+
+static long write_calls = 0;
+static long write_bytes = 0;
+
+/*
+ *	Counts terminal writes, then performs them.
+ */
+ssize_t write( int fd, const void * buffer, size_t count ) {
+	if ( fd == STDOUT_FILENO ) {
+		write_calls++;
+		write_bytes += count;
+	}
+
+	return syscall( SYS_write, fd, buffer, count );
+}
+
+static double now( void ) {
+	struct timespec t;
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/*
+ *	Draws a run of frames and reports how long show_screen took.
+ */
+static void run_scene( long frames, Bench_Result * result ) {
+	screen_rect platforms[NO_PLATFORMS];
+	screen_rect sprites[NO_SPRITES];
+	memset( platforms, 0, sizeof( platforms ) );
+	memset( sprites, 0, sizeof( sprites ) );
+
+	setup_screen();
+
+	int w = screen_width();
+	int h = screen_height();
+
+	write_calls = 0;
+	write_bytes = 0;
+	result->seconds = 0;
+	result->worst_seconds = 0;
+
+	for ( long frame = 0; frame < frames; frame++ ) {
+		set_clip_rect( 0, 2, w, h - 5 );
+		clear_screen();
+
+		// Platforms rise one row every four frames and wrap around.
+		for ( int i = 0; i < NO_PLATFORMS; i++ ) {
+			int x = ( i * 23 ) % ( w - 12 );
+			int y = h - 1 - ( int ) ( ( frame / 4 + i * ( h / NO_PLATFORMS ) ) % h );
+			draw_hline( x, x + 9, y, '=' );
+			draw_hline( x, x + 9, y + 1, '=' );
+			mark_dirty_move( &platforms[i], x, y, 10, 2 );
+		}
+
+		// Sprites bounce diagonally.
+		for ( int i = 0; i < NO_SPRITES; i++ ) {
+			int span_x = w - 4, span_y = h - 8;
+			int px = ( frame + i * 17 ) % ( 2 * span_x );
+			int py = ( frame / 2 + i * 11 ) % ( 2 * span_y );
+			int x = px < span_x ? px : 2 * span_x - px;
+			int y = 2 + ( py < span_y ? py : 2 * span_y - py );
+
+			for ( int row = 0; row < 3; row++ ) {
+				draw_hline( x, x + 2, y + row, "0|M"[row] );
+			}
+
+			mark_dirty_move( &sprites[i], x, y, 3, 3 );
+		}
+
+		reset_clip_rect();
+
+		if ( frame % 40 == 0 ) {
+			draw_formatted( 0, 0, "Frame: %ld", frame );
+			draw_hline( 0, w - 1, 1, '-' );
+			draw_hline( 0, w - 1, h - 3, '-' );
+			mark_dirty( 0, 0, w, 2 );
+			mark_dirty( 0, h - 3, w, 1 );
+		}
+
+		double start = now();
+		show_screen();
+		double elapsed = now() - start;
+
+		result->seconds += elapsed;
+
+		if ( elapsed > result->worst_seconds ) result->worst_seconds = elapsed;
+	}
+
+	result->frames = frames;
+	result->writes = write_calls;
+	result->bytes = write_bytes;
+
+	cleanup_screen();
+}
+
+int main( int argc, char * argv[] ) {
+	long frames = argc > 1 ? atol( argv[1] ) : DEFAULT_FRAMES;
+
+	if ( frames <= 0 ) {
+		fprintf( stderr, "Usage: %s [frames]\n", argv[0] );
+		return 1;
+	}
+
+	int results[2];
+
+	if ( pipe( results ) != 0 ) {
+		perror( "pipe" );
+		return 1;
+	}
+
+	struct winsize size = { BENCH_HEIGHT, BENCH_WIDTH, 0, 0 };
+	int terminal;
+	pid_t child = forkpty( &terminal, NULL, NULL, &size );
+
+	if ( child < 0 ) {
+		perror( "forkpty" );
+		return 1;
+	}
+
+	if ( child == 0 ) {
+		Bench_Result result;
+		setenv( "TERM", "xterm", 0 );
+		setenv( "ZDK_ANSI_SYNC", "1", 0 ); // the pseudo-terminal cannot answer the query
+		run_scene( frames, &result );
+		syscall( SYS_write, results[1], &result, sizeof( result ) );
+		_exit( 0 );
+	}
+
+	close( results[1] );
+
+	// Play the terminal: read everything the child sends until it exits.
+	long received = 0;
+	char buffer[65536];
+
+	for ( ;; ) {
+		struct pollfd fd = { terminal, POLLIN, 0 };
+
+		if ( poll( &fd, 1, 1000 ) <= 0 ) break;
+
+		ssize_t n = read( terminal, buffer, sizeof( buffer ) );
+
+		if ( n <= 0 ) break;
+
+		received += n;
+	}
+
+	waitpid( child, NULL, 0 );
+
+	Bench_Result result;
+
+	if ( read( results[0], &result, sizeof( result ) ) != sizeof( result ) ) {
+		fprintf( stderr, "%s: benchmark did not complete\n", BENCH_BACKEND );
+		return 1;
+	}
+
+	printf( "%-8s %7ld frames %9.1f bytes/frame %6.2f writes/frame %8.2f us/frame %8.2f us worst %9ld bytes received\n",
+		BENCH_BACKEND, result.frames,
+		( double ) result.bytes / result.frames,
+		( double ) result.writes / result.frames,
+		result.seconds / result.frames * 1e6,
+		result.worst_seconds * 1e6,
+		received );
+
+	return 0;
+}
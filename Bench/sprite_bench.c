@@ -0,0 +1,118 @@
+/*
+ *	sprite_bench.c
+ *
+ *	Compares moving many sprites one at a time (sprite_create, sprite_step)
+ *	with moving them in bulk from a sprite pool (sprite_pool_create,
+ *	sprite_step_all). Also measures the cost of tearing all sprites down
+ *	and setting them up again, as the game does on every reset.
+ *
+ *	Usage: sprite_bench [sprites] [steps]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "cab202_sprites.h"
+#include "cab202_sprite_pool.h"
+
+#define DEFAULT_SPRITES 10000
+#define DEFAULT_STEPS 1000
+#define RESETS 100
+
+static double now( void ) {
+	struct timespec t;
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main( int argc, char * argv[] ) {
+	int sprites = argc > 1 ? atoi( argv[1] ) : DEFAULT_SPRITES;
+	int steps = argc > 2 ? atoi( argv[2] ) : DEFAULT_STEPS;
+	static char bitmap[] = "0|M";
+
+	if ( sprites <= 0 || steps <= 0 ) {
+		fprintf( stderr, "Usage: %s [sprites] [steps]\n", argv[0] );
+		return 1;
+	}
+
+	// Individually allocated sprites.
+	sprite_id * single = malloc( sprites * sizeof( sprite_id ) );
+	double start = now();
+
+	for ( int r = 0; r < RESETS; r++ ) {
+		for ( int i = 0; i < sprites; i++ ) {
+			if ( r > 0 ) sprite_destroy( single[i] );
+			single[i] = sprite_create( i % 70, i % 50, 1, 3, bitmap );
+			sprite_turn_to( single[i], 0.01 * ( i % 7 ), -0.02 * ( i % 5 ) );
+		}
+	}
+
+	double single_reset = now() - start;
+	start = now();
+
+	for ( int s = 0; s < steps; s++ ) {
+		for ( int i = 0; i < sprites; i++ ) {
+			sprite_step( single[i] );
+		}
+	}
+
+	double single_step = now() - start;
+	double single_check = 0;
+
+	for ( int i = 0; i < sprites; i++ ) {
+		single_check += single[i]->x + single[i]->y;
+		sprite_destroy( single[i] );
+	}
+
+	free( single );
+
+	// Pooled sprites.
+	sprite_pool pool;
+
+	if ( !sprite_pool_init( &pool, sprites ) ) {
+		fprintf( stderr, "Unable to allocate a pool of %d sprites\n", sprites );
+		return 1;
+	}
+
+	start = now();
+
+	for ( int r = 0; r < RESETS; r++ ) {
+		sprite_pool_clear( &pool );
+
+		for ( int i = 0; i < sprites; i++ ) {
+			pool_sprite_id id = sprite_pool_create( &pool, i % 70, i % 50, 1, 3, bitmap );
+			pool.dx[id] = 0.01 * ( i % 7 );
+			pool.dy[id] = -0.02 * ( i % 5 );
+		}
+	}
+
+	double pool_reset = now() - start;
+	start = now();
+
+	for ( int s = 0; s < steps; s++ ) {
+		sprite_step_all( &pool );
+	}
+
+	double pool_step = now() - start;
+	double pool_check = 0;
+
+	for ( int i = 0; i < sprites; i++ ) {
+		pool_check += pool.x[i] + pool.y[i];
+	}
+
+	sprite_pool_release( &pool );
+
+	if ( single_check != pool_check ) {
+		fprintf( stderr, "Pooled sprites did not end up where individual sprites did\n" );
+		return 1;
+	}
+
+	double moves = (double) sprites * steps;
+	double setups = (double) sprites * RESETS;
+
+	printf( "%d sprites, %d steps, %d resets\n", sprites, steps, RESETS );
+	printf( "%-8s %8.3f ns/sprite step %8.2f ns/sprite reset\n", "single", single_step / moves * 1e9, single_reset / setups * 1e9 );
+	printf( "%-8s %8.3f ns/sprite step %8.2f ns/sprite reset\n", "pool", pool_step / moves * 1e9, pool_reset / setups * 1e9 );
+
+	return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ *	tick_bench.c
+ *
+ *	Compares two ways of running a game loop with 25 ms simulation ticks
+ *	for a few seconds of real time, with some work done on every tick:
+ *
+ *	-	"timer": timer_expired on a timer and a flat 10 ms timer_pause per
+ *		pass, as event_loop used to do.
+ *	-	"scheduler": a tick_scheduler, sleeping until each deadline.
+ *
+ *	For each it reports how many ticks ran against how many fell due, and
+ *	how late they ran relative to an ideal grid of 25 ms steps.
+ *
+ *	Usage: tick_bench [seconds] [work_ms]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "cab202_timers.h"
+
+#define STEP_MS 25
+#define POLL_MS 10
+
+static timer_ns start;
+static long long count;
+static double late_sum, late_sum_sq, late_max;
+
+/*
+ *	Records a tick run at the current time, the n-th since start.
+ */
+static void record_tick( void ) {
+	double late = ( get_monotonic_ns() - start - ( count + 1 ) * STEP_MS * 1000000LL ) / 1e6;
+
+	late_sum += late;
+	late_sum_sq += late * late;
+	if ( count == 0 || late > late_max ) late_max = late;
+	count++;
+}
+
+/*
+ *	Busy-waits, standing in for the cost of simulating and drawing a tick.
+ */
+static void work( double ms ) {
+	timer_ns until = get_monotonic_ns() + (timer_ns) ( ms * 1e6 );
+	while ( get_monotonic_ns() < until ) {}
+}
+
+static void report( const char * name, double seconds ) {
+	double mean = late_sum / count;
+	double sd = sqrt( late_sum_sq / count - mean * mean );
+	long long expected = (long long) ( seconds * 1000 / STEP_MS );
+
+	printf( "%-10s %5lld/%lld ticks   late: mean %7.3f ms  sd %7.3f ms  max %7.3f ms\n",
+		name, count, expected, mean, sd, late_max );
+}
+
+static void reset_counts( void ) {
+	start = get_monotonic_ns();
+	count = 0;
+	late_sum = late_sum_sq = late_max = 0;
+}
+
+int main( int argc, char * argv[] ) {
+	double seconds = argc > 1 ? atof( argv[1] ) : 3;
+	double work_ms = argc > 2 ? atof( argv[2] ) : 4;
+
+	if ( seconds <= 0 || work_ms < 0 ) {
+		fprintf( stderr, "Usage: %s [seconds] [work_ms]\n", argv[0] );
+		return 1;
+	}
+
+	timer_ns length = (timer_ns) ( seconds * NANOSECONDS );
+
+	printf( "%.1f s of %d ms ticks, %.1f ms of work per tick\n", seconds, STEP_MS, work_ms );
+
+	// Timer reset to "now" on expiry, with a flat pause.
+	reset_counts();
+	timer_id timer = create_timer( STEP_MS );
+
+	while ( get_monotonic_ns() - start < length ) {
+		if ( timer_expired( timer ) ) {
+			record_tick();
+			work( work_ms );
+		}
+
+		timer_pause( POLL_MS );
+	}
+
+	free( timer );
+	report( "timer", seconds );
+
+	// Fixed-step scheduler with absolute deadlines.
+	reset_counts();
+	tick_scheduler scheduler;
+	timer_begin_frame();
+	scheduler_init( &scheduler, STEP_MS, 4 );
+
+	while ( get_monotonic_ns() - start < length ) {
+		timer_begin_frame();
+		int ticks = scheduler_ticks_due( &scheduler );
+
+		for ( int i = 0; i < ticks; i++ ) {
+			record_tick();
+			work( work_ms );
+		}
+
+		scheduler_sleep( &scheduler, POLL_MS );
+	}
+
+	report( "scheduler", seconds );
+
+	return 0;
+}
@@ -0,0 +1,125 @@
+/*
+ *	wheel_bench.c
+ *
+ *	Compares two ways of keeping many timers running, each of which fires
+ *	repeatedly with its own random period:
+ *
+ *	-	"polled": one malloc'd countdown per timer, every one checked on
+ *		every tick, as the boss's appear and turn delays used to be.
+ *	-	"wheel": a timer_wheel, which only visits timers as they fall due.
+ *
+ *	For each number of timers it reports the time taken per tick, and the
+ *	number of timers fired, which is the same for both.
+ *
+ *	Usage: wheel_bench [ticks]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cab202_timers.h"
+#include "cab202_timer_wheel.h"
+
+#define MAX_PERIOD 2000
+
+typedef struct countdown {
+	int remaining;
+	int period;
+} countdown;
+
+static unsigned int seed;
+static long long fired;
+static timer_wheel wheel;
+
+/*
+ *	Periods are drawn from a private generator, so both methods see the same
+ *	sequence.
+ */
+static int next_period( void ) {
+	seed = seed * 1103515245 + 12345;
+	return 1 + ( seed >> 8 ) % MAX_PERIOD;
+}
+
+static void on_fire( void * data, int event ) {
+	fired++;
+}
+
+static double run_polled( int timers, int ticks ) {
+	countdown ** all = malloc( timers * sizeof( countdown * ) );
+
+	seed = 1;
+	fired = 0;
+
+	for ( int i = 0; i < timers; i++ ) {
+		all[i] = malloc( sizeof( countdown ) );
+		all[i]->period = next_period();
+		all[i]->remaining = all[i]->period;
+	}
+
+	timer_ns start = get_monotonic_ns();
+
+	for ( int t = 0; t < ticks; t++ ) {
+		for ( int i = 0; i < timers; i++ ) {
+			if ( --all[i]->remaining == 0 ) {
+				fired++;
+				all[i]->remaining = all[i]->period;
+			}
+		}
+	}
+
+	timer_ns elapsed = get_monotonic_ns() - start;
+
+	for ( int i = 0; i < timers; i++ ) {
+		free( all[i] );
+	}
+
+	free( all );
+	return (double) elapsed / ticks;
+}
+
+static double run_wheel( int timers, int ticks ) {
+	seed = 1;
+	fired = 0;
+
+	timer_wheel_init( &wheel, timers );
+
+	for ( int i = 0; i < timers; i++ ) {
+		int period = next_period();
+		timer_wheel_schedule( &wheel, period, period, i, on_fire, NULL );
+	}
+
+	timer_ns start = get_monotonic_ns();
+	timer_wheel_advance( &wheel, ticks );
+	timer_ns elapsed = get_monotonic_ns() - start;
+
+	timer_wheel_release( &wheel );
+	return (double) elapsed / ticks;
+}
+
+int main( int argc, char * argv[] ) {
+	int ticks = argc > 1 ? atoi( argv[1] ) : 20000;
+
+	if ( ticks <= 0 ) {
+		fprintf( stderr, "Usage: %s [ticks]\n", argv[0] );
+		return 1;
+	}
+
+	static const int counts[] = { 10, 100, 1000, 10000, 65536 };
+
+	printf( "%d ticks, periods of 1 to %d ticks\n", ticks, MAX_PERIOD );
+	printf( "%8s %14s %14s %12s\n", "timers", "polled ns/tick", "wheel ns/tick", "fired" );
+
+	for ( int i = 0; i < (int) ( sizeof( counts ) / sizeof( counts[0] ) ); i++ ) {
+		double polled = run_polled( counts[i], ticks );
+		long long polled_fired = fired;
+		double wheel_ns = run_wheel( counts[i], ticks );
+
+		if ( fired != polled_fired ) {
+			fprintf( stderr, "Timer counts differ: %lld polled, %lld wheel\n", polled_fired, fired );
+			return 1;
+		}
+
+		printf( "%8d %14.1f %14.1f %12lld\n", counts[i], polled, wheel_ns, fired );
+	}
+
+	return 0;
+}
@@ -0,0 +1,175 @@
+#include <stdlib.h>
+#include <math.h>
+#include "cab202_graphics.h"
+#include "cab202_sprites.h"
+#include "cab202_bitmap_atlas.h"
+#include "boss_sprite.h"
+
+// ----------------------------------------------------------------
+// Boss functions
+// ----------------------------------------------------------------
+
+/*
+ * Draws the boss, and reports the area it covers.
+ */
+void draw_boss( boss_id* boss ){
+	sprite_id sprite = boss->sprite_boss;
+	
+	body_to_sprite( &boss->body, sprite );
+	
+	if ( sprite->is_visible ){
+		mark_dirty_move( &boss->drawn, round( sprite->x ), round( sprite->y ), sprite->width, sprite->height );
+	} else {
+		mark_dirty_move( &boss->drawn, 0, 0, 0, 0 );
+	}
+	
+	sprite_draw( sprite );
+}
+
+/*
+ * Creates a circular bitmap with the specified character
+ */
+bitmap_id create_bitmap( int radius, char character ){
+	int diameter = 2* radius;
+	int area = diameter * diameter;
+	char bitmap[area]; // the atlas keeps its own copy
+	double center = radius;
+	int row, column, distance;
+	
+	for ( int i = 0; i < area; i++ ){ // loops through each element
+		row = i % diameter; // convert to separate row and index column
+		column = i / diameter;
+		
+		distance = calc_dist( center, center, row, column ); // calculates array's distance from center
+		
+		if ( distance < round(radius) ){
+			bitmap[i] = character; // fills place with character
+		} else {
+			bitmap[i] = ' '; // fills character with empty space, otherwise.
+		}
+	} 
+	
+	return bitmap_intern( diameter, diameter, bitmap );
+}
+
+/*
+ * Creates directional bitmaps
+ */
+void create_directional_bitmaps( boss_id* boss ){
+	boss->bitmap_up = create_bitmap( boss->radius, '^');
+	boss->bitmap_down = create_bitmap( boss->radius, 'v');
+	boss->bitmap_left = create_bitmap( boss->radius, '<');
+	boss->bitmap_right = create_bitmap( boss->radius, '>');
+}
+
+/*
+ * Releases the bitmaps. An image stays in the atlas while the sprite still shows it.
+ */
+void clear_bitmaps( boss_id* boss ){
+	bitmap_release( boss->bitmap_up );
+	bitmap_release( boss->bitmap_down );
+	bitmap_release( boss->bitmap_left );
+	bitmap_release( boss->bitmap_right );
+}
+
+/*
+ * Changes the bitmap based on direction. Only the image handle changes.
+ */
+void change_bitmap( boss_id* boss ){
+	if ( abs( num_trunc( boss->body.dx ) ) > abs( num_trunc( boss->body.dy ) ) // if dx is bigger than dy
+		&& boss->body.dx >= 0 ){ // and is bigger than zero
+		sprite_set_bitmap( boss->sprite_boss, boss->bitmap_right ); // bitmap is right
+	} else if (  abs( num_trunc( boss->body.dx ) ) > abs( num_trunc( boss->body.dy ) ) // if dx is bigger than dy
+		&& boss->body.dx < 0 ){ // and is less than zero
+		sprite_set_bitmap( boss->sprite_boss, boss->bitmap_left ); // bitmap is left
+	} else if (  abs( num_trunc( boss->body.dx ) ) < abs( num_trunc( boss->body.dy ) ) // if dx is less than dy
+		&& boss->body.dx >= 0 ){ // and is greater than zero
+		sprite_set_bitmap( boss->sprite_boss, boss->bitmap_up ); // bitmap is up
+	} else if (  abs( num_trunc( boss->body.dx ) ) < abs( num_trunc( boss->body.dy ) ) // if dx is less than dy
+		&& boss->body.dx < 0 ){ // and is less than zero
+		sprite_set_bitmap( boss->sprite_boss, boss->bitmap_down ); // bitmap is down
+	} 
+}
+
+/*
+ * Calculates the absolute distance between two points.
+ */
+double calc_dist( double x_c, double y_c, double row, double column ){
+	int dx = x_c - column;
+	int dy = y_c - row;
+	double distance = sqrt( ( dx*dx) + (dy*dy) );
+	return distance;
+}
+/*
+ * Tries to move boss. Returns false otherwise.
+ */
+bool process_boss( boss_id* boss, int level ){
+	bool boss_moved = false;
+	
+	if( boss->sprite_boss->is_visible && level == 3 ){ // don't move boss unless on level 3
+		
+		int x0 = num_round( boss->body.x );
+		int y0 = num_round( boss->body.y );
+		
+		move_boss( boss );
+		
+		boss_moved = num_round( boss->body.x ) != x0
+					|| num_round( boss->body.y ) != y0;
+	} 
+	
+	return boss_moved;
+}
+
+/*
+ * Moves boss sprite. Turns boss in a full circle after a delay.
+ */
+void move_boss( boss_id* boss ){
+	if ( boss->appeared ){
+		if( boss->turning && ( boss->turn_total < 360 )){ // if delay has expired, and boss has not turned full 360 degrees
+		fixed_sprite_turn( &boss->body, 2 ); // turns sprite
+		boss->turn_total ++;
+		}
+	
+		body_step( &boss->body ); // moves boss sprite
+	}
+	
+	change_bitmap( boss );
+	
+}
+
+/*
+ * Handles the boss's timer events: starts it moving once the appear delay
+ * has passed, and turning once the turn delay has passed after that.
+ */
+void boss_event( void* data, int event ){
+	boss_id* boss = data;
+	
+	if ( event == BOSS_APPEAR ){
+		boss->appeared = true;
+	} else if ( event == BOSS_TURN ){
+		boss->turning = true;
+	}
+}
+
+/*
+*	fixed_sprite_turn:
+*
+*	Sets the internally stored direction. That is, the step that is taken when
+*	the sprite moves forward or backward.
+*
+*	The new direction is relative to the old one. If the old direction is 0,0 then
+*	the new one will also be 0,0.
+*
+*	Input:
+*		b: The body to turn.
+*		degrees: The angle to turn, in whole degrees so that the sine and
+*			cosine can be looked up in fixed-point builds.
+*/
+void fixed_sprite_turn( body* b, int degrees ) {
+	num s = num_sin_deg( degrees );
+	num c = num_cos_deg( degrees );
+	num dx = num_mul( c, b->dx ) + num_mul( s, b->dy );
+	num dy = num_mul( -s, b->dx ) + num_mul( c, b->dy );
+	b->dx = dx;
+	b->dy = dy;
+}
\ No newline at end of file
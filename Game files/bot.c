@@ -0,0 +1,124 @@
+#include <stdlib.h>
+#include "cab202_graphics.h"
+#include "cab202_work_pool.h"
+#include "bot.h"
+
+// ----------------------------------------------------------------
+// Bot functions
+// ----------------------------------------------------------------
+
+/*
+ * Allocates a bot searching with threads workers. Returns false if memory could
+ * not be allocated.
+ */
+bool bot_init( game_bot* bot, int threads ){
+	bot->threads = threads;
+	bot->game = NULL;
+	bot->searched = 0;
+	bot->scratch = calloc( threads, sizeof( game_session ) );
+	bool allocated = bot->scratch != NULL;
+	
+	for ( int i = 0; i < threads && allocated; i++ ){
+		allocated = session_init( &bot->scratch[i], 0 );
+	}
+	
+	if ( !allocated ){
+		bot_release( bot );
+	}
+	
+	return allocated;
+}
+
+/*
+ * Frees the scratch sessions of a bot.
+ */
+void bot_release( game_bot* bot ){
+	for ( int i = 0; i < bot->threads && bot->scratch != NULL; i++ ){
+		session_release( &bot->scratch[i] ); // harmless on sessions never allocated
+	}
+	free( bot->scratch );
+	bot->scratch = NULL;
+}
+
+/*
+ * Searches the plans from the current state of game, and returns the key to
+ * press on its next step (ERR for none). game is only read.
+ */
+int bot_choose( game_bot* bot, const game_session* game ){
+	bot->game = game;
+	
+	if ( bot->threads > 1 ){
+		work_pool_run( BOT_PLANS, bot->threads, bot_play, bot, NULL );
+	} else {
+		for ( int plan = 0; plan < BOT_PLANS; plan++ ){
+			bot_play( bot, plan, 0 );
+		}
+	}
+	
+	int best = 0;
+	
+	for ( int plan = 0; plan < BOT_PLANS; plan++ ){
+		if ( bot->values[plan] > bot->values[best] ){
+			best = plan;
+		}
+		bot->searched += bot->steps[plan];
+	}
+	
+	return bot_plan_key( best, 0 );
+}
+
+/*
+ * Plays one plan ahead in the scratch session of worker, and records its value.
+ * Run by bot_choose, possibly on several threads at once.
+ */
+void bot_play( void* context, long plan, int worker ){
+	game_bot* bot = context;
+	game_session* session = &bot->scratch[worker];
+	
+	session_copy( session, bot->game );
+	
+	int score = session->player.score;
+	int step = 0;
+	
+	while ( step < BOT_HORIZON && session->player.player_sprite->is_visible ){
+		session_step( session, bot_plan_key( plan, step ) );
+		step++;
+	}
+	
+	bot->steps[plan] = step;
+	
+	if ( !session->player.player_sprite->is_visible ){
+		bot->values[plan] = step - BOT_DEATH;
+	} else {
+		int row = num_trunc( session->player.body.y );
+		int clearance = row - 2; // rows above the player before the top kills it
+		
+		if ( screen_height() - 5 - row < clearance ){
+			clearance = screen_height() - 5 - row; // rows below before the bottom does
+		}
+		if ( clearance > BOT_CLEARANCE ){
+			clearance = BOT_CLEARANCE;
+		}
+		
+		bot->values[plan] = BOT_SCORE * ( session->player.score - score ) + clearance;
+	}
+}
+
+/*
+ * Returns the key plan presses on step steps ahead (ERR for none). The first
+ * segment is the most significant digit of the plan, in base BOT_KEYS.
+ */
+int bot_plan_key( int plan, int step ){
+	static const int keys[BOT_KEYS] = { ERR, KEY_LEFT, KEY_RIGHT, KEY_UP, KEY_DOWN };
+	int segment = step / BOT_SEGMENT_STEPS;
+	
+	if ( segment >= BOT_SEGMENTS ){
+		return ERR;
+	}
+	
+	for ( int s = segment + 1; s < BOT_SEGMENTS; s++ ){
+		plan /= BOT_KEYS;
+	}
+	
+	return keys[plan % BOT_KEYS];
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef __BOT_H__
+#define __BOT_H__
+
+#include <stdbool.h>
+#include "session.h"
+
+#define BOT_KEYS 5 // choices for each segment of a plan: no key, or an arrow
+#define BOT_SEGMENTS 2 // segments of a plan
+#define BOT_PLANS 25 // BOT_KEYS to the power BOT_SEGMENTS
+#define BOT_SEGMENT_STEPS 20 // steps each segment presses its key on (0.5 s)
+#define BOT_HORIZON 200 // steps each plan is played ahead (5 s)
+#define BOT_DEATH 1000 // taken off the value of a plan which loses a life
+#define BOT_SCORE 20 // added to the value of a plan for each point scored
+#define BOT_CLEARANCE 8 // most rows from the deadly top and bottom worth having
+
+/*
+ * Type definition for a player which chooses its own keys.
+ *
+ * Before each step, every plan is played ahead BOT_HORIZON steps in a copy of
+ * the game, and the first key of the best is pressed. A plan presses one key
+ * (or none) on every step of its first segment, then another on every step of
+ * the second, then nothing. The plans are shared out between workers, each
+ * playing in a scratch session of its own, so copying and stepping allocate
+ * nothing.
+ *
+ * A plan which loses a life is worth less than any which does not, and less
+ * the sooner it does. Otherwise it is worth more for each point scored and
+ * for ending clear of the top and bottom of the screen. Ties go to the plan
+ * numbered first, which presses fewer keys, so the choice depends only on
+ * the game.
+ */
+typedef struct game_bot{
+	int threads; // workers sharing the plans
+	game_session* scratch; // session for each worker to play plans in
+	const game_session* game; // game being searched by bot_choose
+	
+	int values[BOT_PLANS]; // value of each plan, in the last search
+	int steps[BOT_PLANS]; // steps each plan was played, in the last search
+	long long searched; // steps played by every search so far
+} game_bot;
+
+// ----------------------------------------------------------------
+// Forward declaration of functions
+// ----------------------------------------------------------------
+bool bot_init( game_bot* bot, int threads );
+void bot_release( game_bot* bot );
+int bot_choose( game_bot* bot, const game_session* game );
+void bot_play( void* context, long plan, int worker );
+int bot_plan_key( int plan, int step );
+
+#endif
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include <string.h>
+#include "cab202_timers.h"
+#include "frame_stats.h"
+
+// ----------------------------------------------------------------
+// Frame timing functions
+// ----------------------------------------------------------------
+
+/*
+ * Clears the statistics, for a loop running steps of step_ms milliseconds.
+ */
+void frame_stats_init( frame_stats* stats, long step_ms ){
+	memset( stats, 0, sizeof( frame_stats ) );
+	stats->step_ns = (timer_ns) step_ms * ( NANOSECONDS / MILLISECONDS );
+	stats->late_ns = (timer_ns) FRAME_LATE_MS * ( NANOSECONDS / MILLISECONDS );
+}
+
+/*
+ * Starts timing a pass of the loop. Call after timer_begin_frame: if the last
+ * pass waited for a deadline, the frame time shows how late it woke.
+ */
+void frame_begin( frame_stats* stats ){
+	if ( stats->deadline > 0 && get_frame_ns() - stats->deadline > stats->late_ns ){
+		stats->late++;
+	}
+	
+	stats->start = stats->last = get_host_ns();
+	stats->discard = false;
+	
+	for ( int p = 0; p < FRAME_PHASES; p++ ){
+		stats->lap_ns[p] = 0;
+		stats->ran[p] = false;
+	}
+}
+
+/*
+ * Adds the time since the last lap to phase.
+ */
+void frame_lap( frame_stats* stats, int phase ){
+	timer_ns now = get_host_ns();
+	stats->lap_ns[phase] += now - stats->last;
+	stats->ran[phase] = true;
+	stats->last = now;
+}
+
+/*
+ * Leaves the current pass out of the statistics. Called when it waits for a key.
+ */
+void frame_discard( frame_stats* stats ){
+	stats->discard = true;
+}
+
+/*
+ * Ends the pass, adding its phases to the histograms unless it was discarded.
+ * deadline is the frame time the loop is about to wait for, or 0 if it will not wait.
+ */
+void frame_end( frame_stats* stats, timer_ns deadline ){
+	stats->deadline = stats->discard ? 0 : deadline; // a wait for a key has no deadline
+	
+	if ( stats->discard ){
+		return;
+	}
+	
+	for ( int p = 0; p < FRAME_PHASES; p++ ){
+		if ( stats->ran[p] ){
+			phase_histogram* h = &stats->phases[p];
+			h->buckets[frame_bucket( stats->lap_ns[p] )]++;
+			h->count++;
+			
+			if ( stats->lap_ns[p] > h->max_ns ){
+				h->max_ns = stats->lap_ns[p];
+			}
+		}
+	}
+	
+	if ( stats->last - stats->start > stats->step_ns ){
+		stats->overruns++;
+	}
+	
+	stats->frames++;
+}
+
+/*
+ * Returns the bucket holding a time. Times under 4 ns have a bucket each; above
+ * that, each doubling is split into four buckets, so a bucket's bounds are within
+ * a quarter of each other.
+ */
+int frame_bucket( timer_ns ns ){
+	if ( ns < 4 ){
+		return ( ns < 0 ) ? 0 : (int) ns;
+	}
+	
+	int e = 63 - __builtin_clzll( (unsigned long long) ns ); // ns lies in [2^e, 2^(e+1))
+	int bucket = ( e - 1 ) * 4 + (int) ( ( ns >> ( e - 2 ) ) & 3 );
+	
+	return ( bucket < FRAME_BUCKETS ) ? bucket : FRAME_BUCKETS - 1;
+}
+
+/*
+ * Returns the upper bound of a bucket: the longest time it holds.
+ */
+timer_ns frame_bucket_ns( int bucket ){
+	if ( bucket < 4 ){
+		return bucket;
+	}
+	
+	int e = bucket / 4 + 1;
+	
+	return ( (timer_ns) ( 4 + bucket % 4 + 1 ) << ( e - 2 ) ) - 1;
+}
+
+/*
+ * Returns the time which percent of the recorded times do not exceed, to the
+ * upper bound of its bucket, and no more than the longest. 0 if none are recorded.
+ */
+timer_ns phase_percentile( phase_histogram* histogram, int percent ){
+	long long seen = 0;
+	
+	if ( histogram->count == 0 ){
+		return 0;
+	}
+	
+	for ( int b = 0; b < FRAME_BUCKETS; b++ ){
+		seen += histogram->buckets[b];
+		
+		if ( seen * 100 >= histogram->count * percent ){
+			timer_ns bound = frame_bucket_ns( b );
+			return ( bound < histogram->max_ns ) ? bound : histogram->max_ns;
+		}
+	}
+	
+	return histogram->max_ns;
+}
\ No newline at end of file
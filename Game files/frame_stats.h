@@ -0,0 +1,64 @@
+#ifndef __FRAME_STATS_H__
+#define __FRAME_STATS_H__
+
+#include <stdbool.h>
+#include "cab202_timers.h"
+
+// Phases of a pass of the event loop
+#define PHASE_INPUT 0 // reading and acting on a key
+#define PHASE_SIMULATION 1 // the steps due
+#define PHASE_DRAW 2 // drawing into the screen buffer
+#define PHASE_REFRESH 3 // show_screen sending the changes to the terminal
+#define FRAME_PHASES 4
+
+#define FRAME_BUCKETS 160 // four per doubling, from 1 ns to about 18 minutes
+#define FRAME_LATE_MS 1 // waking this much after the deadline waited for is late
+
+/*
+ * Type definition for the times taken by one phase, as a histogram with
+ * buckets of fixed bounds (see frame_bucket), so recording a time costs the
+ * same however many have been recorded.
+ */
+typedef struct phase_histogram{
+	long long count; // times recorded
+	timer_ns max_ns; // longest time recorded
+	long buckets[FRAME_BUCKETS];
+} phase_histogram;
+
+/*
+ * Type definition for the timing of the passes of the event loop.
+ *
+ * Each pass is timed on the host clock, with a lap at the end of each phase.
+ * The times are only added to the histograms when the pass ends, so a pass
+ * which waited for a key (to begin, or after a lost life) can be left out.
+ */
+typedef struct frame_stats{
+	phase_histogram phases[FRAME_PHASES];
+	timer_ns step_ns; // a pass whose work takes longer than this has overrun
+	timer_ns late_ns;
+	
+	timer_ns start; // host time at the start of the current pass
+	timer_ns last; // host time of the last lap
+	timer_ns lap_ns[FRAME_PHASES]; // time of each phase in the current pass
+	bool ran[FRAME_PHASES]; // phases which ran in the current pass
+	bool discard; // the current pass waited for a key, and is not recorded
+	timer_ns deadline; // frame time the last pass waited for, or 0 if it did not wait
+	
+	long long frames; // passes recorded
+	long long overruns; // passes whose work took longer than a step
+	long long late; // passes which woke late for the deadline they waited for
+} frame_stats;
+
+// ----------------------------------------------------------------
+// Forward declaration of functions
+// ----------------------------------------------------------------
+void frame_stats_init( frame_stats* stats, long step_ms );
+void frame_begin( frame_stats* stats );
+void frame_lap( frame_stats* stats, int phase );
+void frame_discard( frame_stats* stats );
+void frame_end( frame_stats* stats, timer_ns deadline );
+int frame_bucket( timer_ns ns );
+timer_ns frame_bucket_ns( int bucket );
+timer_ns phase_percentile( phase_histogram* histogram, int percent );
+
+#endif
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include "cab202_graphics.h"
+#include "cab202_timers.h"
+#include "game_view.h"
+
+// ----------------------------------------------------------------
+// Drawing functions
+// ----------------------------------------------------------------
+
+/*
+ * Places the menu elements for a screen whose largest location is (max_x,max_y).
+ * They are drawn in full at the next draw_hud.
+ */
+void setup_view( game_view* view, int max_x, int max_y ){
+	view->max_x = max_x;
+	view->max_y = max_y;
+	setup_hud_field( &view->lives_field, 0, 0 );
+	setup_hud_field( &view->time_field, 58, 0 );
+	setup_hud_field( &view->level_field, 0, max_y - 1 );
+	setup_hud_field( &view->speed_field, max_x - 12, max_y - 1 );
+	setup_hud_field( &view->score_field, 0, max_y );
+	setup_hud_field( &view->overlay_top_field, 2, 1 );
+	setup_hud_field( &view->overlay_bottom_field, 2, max_y - 2 );
+	view->hud_valid = false;
+}
+
+/*
+ *	Draws the game into the screen buffer, without showing it
+ */
+void draw_game( game_view* view, game_session* session ){
+	set_clip_rect( 0, 2, screen_width(), view->max_y - 4 ); // play area, between the borders
+	clear_screen();
+	draw_boss( &session->boss );
+	draw_platforms( &session->platforms ); 
+	draw_player( &session->player ); 
+	reset_clip_rect();
+	draw_hud( view, session );
+	draw_overlay( view );
+}
+
+/*
+ * Draws the menu elements whose values have changed since they were last drawn.
+ * If the HUD rows have been overwritten, blanks them and draws everything.
+ */
+void draw_hud( game_view* view, game_session* session ){
+	if ( !view->hud_valid ){
+		draw_hline( 0, view->max_x, 0, ' ' );
+		draw_hline( 0, view->max_x, view->max_y - 1, ' ' );
+		draw_hline( 0, view->max_x, view->max_y, ' ' );
+		draw_border( view );
+		mark_dirty( 0, 0, screen_width(), 2 );
+		mark_dirty( 0, view->max_y - 2, screen_width(), 3 );
+		
+		invalidate_hud_field( &view->lives_field );
+		invalidate_hud_field( &view->time_field );
+		invalidate_hud_field( &view->level_field );
+		invalidate_hud_field( &view->speed_field );
+		invalidate_hud_field( &view->score_field );
+		invalidate_hud_field( &view->overlay_top_field );
+		invalidate_hud_field( &view->overlay_bottom_field );
+		view->hud_valid = true;
+	}
+	
+	draw_score( view, session );
+	draw_lives( view, session );
+	draw_time( view );
+	draw_level( view, session );
+	draw_speed( view, session );
+}
+
+/*
+ *	Draws score in bottom left corner
+ */
+void draw_score( game_view* view, game_session* session ){
+	if ( hud_field_changed( &view->score_field, session->player.score ) ){
+		draw_hud_field( &view->score_field, "Score: %d", session->player.score );
+	}
+}
+
+/*
+ * Displays remaining lives.
+ */
+void draw_lives( game_view* view, game_session* session ){
+	if ( hud_field_changed( &view->lives_field, session->lives ) ){
+		draw_hud_field( &view->lives_field, "Remaining lives: %d", session->lives );
+	}
+}
+
+/*
+ * Displays elapsed time. Minutes and seconds are only recalculated when a whole second has passed.
+ * The time is that of the current frame, so the clock is not read again.
+ */
+void draw_time( game_view* view ){
+	int elapsed_time = ( get_frame_ns() - view->start_time ) / NANOSECONDS;
+	
+	if ( hud_field_changed( &view->time_field, elapsed_time ) ){
+		int minutes = elapsed_time / 60;
+		int seconds = elapsed_time % 60;
+		draw_hud_field( &view->time_field, "Time: %d:%d", minutes, seconds );
+	}
+}
+
+/*
+ * Draws level indicatior
+ */
+void draw_level( game_view* view, game_session* session ){
+	if ( hud_field_changed( &view->level_field, session->level ) ){
+		draw_hud_field( &view->level_field, "Level %d", session->level );
+	}
+}
+
+/*
+ * Draws speed in the bottom right corner
+ */
+void draw_speed( game_view* view, game_session* session ){
+	int shown = ( session->level == 3 ) ? session->speed : 0; // only shown on level 3
+	
+	if ( shown != 0 && shown != SLOW && shown != NORMAL && shown != FAST ){
+		shown = 1; // changing, whatever the current speed
+	}
+	
+	if ( !hud_field_changed( &view->speed_field, shown ) ){
+		return;
+	}
+	
+	switch( shown ) {
+		case 0:
+			draw_hud_field( &view->speed_field, "" );
+			break;
+			
+		case SLOW: 
+			draw_hud_field( &view->speed_field, "Speed: SLOW" );
+			break;
+		
+		case NORMAL: 
+			draw_hud_field( &view->speed_field, "Speed: NORM" );
+			break;
+			
+		case FAST: 
+			draw_hud_field( &view->speed_field, "Speed: FAST" );
+			break;
+		
+		default:
+			draw_hud_field( &view->speed_field, "Changing..." );
+			break;
+	}
+}
+
+/*
+ * Draws border at top and bottom of screen.
+ */
+void draw_border( game_view* view ){
+	draw_hline( 0, view->max_x, 1, '-' );
+	draw_hline( 0, view->max_x, view->max_y - 2, '-' );
+}
+
+/*
+ * Draws the frame timing over the borders, if there is an overlay: the median, 99th
+ * percentile and longest time of each phase of the event loop, in microseconds, and
+ * the passes which overran a step or woke late. Redrawn only as the text changes.
+ */
+void draw_overlay( game_view* view ){
+	frame_stats* frame = view->overlay;
+	
+	if ( frame == NULL ){
+		return;
+	}
+	
+	long long us[FRAME_PHASES][3];
+	
+	for ( int p = 0; p < FRAME_PHASES; p++ ){
+		us[p][0] = phase_percentile( &frame->phases[p], 50 ) / 1000;
+		us[p][1] = phase_percentile( &frame->phases[p], 99 ) / 1000;
+		us[p][2] = frame->phases[p].max_ns / 1000;
+	}
+	
+	draw_hud_field( &view->overlay_top_field, " input %lld/%lld/%lld  sim %lld/%lld/%lld us p50/p99/max ",
+			us[PHASE_INPUT][0], us[PHASE_INPUT][1], us[PHASE_INPUT][2],
+			us[PHASE_SIMULATION][0], us[PHASE_SIMULATION][1], us[PHASE_SIMULATION][2] );
+	draw_hud_field( &view->overlay_bottom_field, " draw %lld/%lld/%lld  show %lld/%lld/%lld us  %lld over  %lld late ",
+			us[PHASE_DRAW][0], us[PHASE_DRAW][1], us[PHASE_DRAW][2],
+			us[PHASE_REFRESH][0], us[PHASE_REFRESH][1], us[PHASE_REFRESH][2],
+			frame->overruns, frame->late );
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#ifndef __GAME_VIEW_H__
+#define __GAME_VIEW_H__
+
+#include <stdbool.h>
+#include "cab202_timers.h"
+#include "session.h"
+#include "hud.h"
+#include "frame_stats.h"
+
+/*
+ * Type definition for the screen of a game: the play area, and the status text
+ * around it. HUD rows are only redrawn when their values change.
+ */
+typedef struct game_view{
+	int max_x; // the largest visible location
+	int max_y;
+	timer_ns start_time; // start of the round, on the frame clock
+	frame_stats* overlay; // frame timing drawn over the borders, or NULL for none
+	bool hud_valid; // false if the HUD rows must be blanked and redrawn
+	
+	hud_field lives_field;
+	hud_field time_field;
+	hud_field level_field;
+	hud_field speed_field;
+	hud_field score_field;
+	hud_field overlay_top_field;
+	hud_field overlay_bottom_field;
+} game_view;
+
+// ----------------------------------------------------------------
+// Forward declaration of functions
+// ----------------------------------------------------------------
+void setup_view( game_view* view, int max_x, int max_y );
+void draw_game( game_view* view, game_session* session );
+void draw_hud( game_view* view, game_session* session );
+void draw_score( game_view* view, game_session* session );
+void draw_lives( game_view* view, game_session* session );
+void draw_time( game_view* view );
+void draw_level( game_view* view, game_session* session );
+void draw_speed( game_view* view, game_session* session );
+void draw_border( game_view* view );
+void draw_overlay( game_view* view );
+
+#endif
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include "cab202_graphics.h"
+#include "hud.h"
+
+// ----------------------------------------------------------------
+// HUD functions
+// ----------------------------------------------------------------
+
+/*
+ * Places a field at (x,y). The field is drawn at the next update.
+ */
+void setup_hud_field( hud_field* field, int x, int y ){
+	field->x = x;
+	field->y = y;
+	field->length = 0;
+	invalidate_hud_field( field );
+}
+
+/*
+ * Forces the field to be redrawn at the next update.
+ * Use after the text on screen has been erased or overwritten.
+ */
+void invalidate_hud_field( hud_field* field ){
+	field->valid = false;
+	field->length = 0;
+}
+
+/*
+ * Returns true if the field needs to be redrawn to show value, and records value as shown.
+ */
+bool hud_field_changed( hud_field* field, int value ){
+	if ( field->valid && field->value == value ){
+		return false;
+	}
+
+	field->valid = true;
+	field->value = value;
+	return true;
+}
+
+/*
+ * Formats and draws the text of a field, blanking whatever is left of its previous text.
+ */
+void draw_hud_field( hud_field* field, const char* format, ... ){
+	char text[HUD_TEXT_SIZE];
+	va_list args;
+
+	va_start( args, format );
+	int length = vsnprintf( text, HUD_TEXT_SIZE, format, args );
+	va_end( args );
+
+	if ( length < 0 ){
+		length = 0;
+	} else if ( length >= HUD_TEXT_SIZE ){
+		length = HUD_TEXT_SIZE - 1;
+	}
+
+	int old_length = field->length;
+
+	if ( length == old_length && memcmp( text, field->text, length ) == 0 ){
+		return; // same text as before
+	}
+
+	draw_chars( field->x, field->y, text, length );
+
+	if ( old_length > length ){
+		draw_hline( field->x + length, field->x + old_length - 1, field->y, ' ' );
+	}
+
+	mark_dirty( field->x, field->y, ( length > old_length ) ? length : old_length, 1 );
+	memcpy( field->text, text, length );
+	field->length = length;
+}
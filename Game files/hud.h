@@ -0,0 +1,34 @@
+#ifndef __HUD_H__
+#define __HUD_H__
+
+#include <stdbool.h>
+
+#define HUD_TEXT_SIZE 64
+
+/*
+ * Type definition for a HUD field: a piece of status text which is only
+ * reformatted and redrawn when the value it shows changes.
+ *
+ * HUD rows lie outside the clip rectangle used to draw the play area, so
+ * text drawn here stays in the screen buffer from one frame to the next.
+ */
+typedef struct hud_field{
+	int x; // location of the text
+	int y;
+
+	bool valid; // false if the field must be redrawn regardless of its value
+	int value; // value shown by the text
+
+	int length; // length of the text currently on screen
+	char text[HUD_TEXT_SIZE];
+} hud_field;
+
+// ----------------------------------------------------------------
+// Forward declaration of functions
+// ----------------------------------------------------------------
+void setup_hud_field( hud_field* field, int x, int y );
+void invalidate_hud_field( hud_field* field );
+bool hud_field_changed( hud_field* field, int value );
+void draw_hud_field( hud_field* field, const char* format, ... );
+
+#endif
\ No newline at end of file
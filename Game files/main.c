@@ -3,10 +3,20 @@
 #include <stdio.h>
 #include <time.h>
 #include <math.h>
+#include <string.h>
+#include <stdarg.h>
 #include "cab202_graphics.h"
 #include "cab202_timers.h"
 #include "cab202_sprites.h"
-#include "player.h"
+#include "cab202_bitmap_atlas.h"
+#include "cab202_timer_wheel.h"
+#include "cab202_work_pool.h"
+#include "session.h"
+#include "bot.h"
+#include "replay.h"
+#include "hud.h"
+#include "frame_stats.h"
+#include "game_view.h"
 
 // The largest visible horizontal location.
 int max_x;
@@ -17,150 +27,282 @@ int max_y;
 // Game-in-progress status: true if and only if the game is finished.
 bool game_over;
 
-// Current level
-int level = 1;
-#define MAX_LEVEL 3
+// The game being played: player, platforms, boss, lives, level and speed
+game_session game;
 
-// Remaining lives left in game.
-int lives = 3;
-
-// Current speed
-int speed = 100;
-int desired_speed = 100;
-bool speed_changing = false; // value indicates whether speed is changing or not
-#define SLOW 25
-#define NORMAL 100
-#define FAST 400
-
-// Start time, in seconds
-double start_time;
-
-// Elapsed minutes
-int minutes = 0;
-
-// Elapsed seconds;
-int seconds = 0;
-
-// Start time, in seconds
-double start_time;
-
-// Player sprite
-player_id player;
-
-// Platform sprite
-#define NO_PLATFORMS 25
-platform platforms[NO_PLATFORMS];
+// Simulation steps run at a fixed rate; between them the loop sleeps until a key arrives
+#define LOOP_STEP 25
+#define MAX_CATCH_UP 4
+tick_scheduler scheduler;
+int held_key = ERR; // key waiting for the next step to act on the player
+
+bool show_stats = false; // report tick timing on exit
+
+// Time spent in each phase of the event loop; drawn over the borders as the view's overlay ('d')
+frame_stats frame;
+const char* phase_names[] = { "input", "simulation", "draw", "refresh" };
+
+// Simulation at full speed, without a terminal (see simulate)
+#define POLICY_RANDOM 0 // presses a random arrow key now and then
+#define POLICY_SCRIPT 1 // repeats a fixed sequence of keys
+#define POLICY_BOT 2 // searches for the best keys (see bot.h)
+#define SIM_WIDTH 80 // screen size simulated, whatever the terminal
+#define SIM_HEIGHT 24
+#define SIM_KEYS 0 // parts of a step timed by simulate: choosing the key, then the parts of session_step
+#define SIM_PLAYER ( 1 + STEP_PLAYER )
+#define SIM_PLATFORMS ( 1 + STEP_PLATFORMS )
+#define SIM_BOSS ( 1 + STEP_BOSS )
+#define SIM_PHASES ( 1 + STEP_PARTS )
+long simulate_ticks = 0; // steps per run, or 0 to play normally
+int simulate_policy = POLICY_RANDOM;
+const char* policy_names[] = { "random", "scripted", "searched" };
 
-// boss sprite
-boss_id boss;
+/*
+ * Type definition for the clock of a simulation run: the time spent in each part
+ * of the steps, and the time of the last lap.
+ */
+typedef struct simulate_clock{
+	timer_ns* phase_ns; // NULL if the run is not timed
+	timer_ns last;
+} simulate_clock;
+
+// Monte Carlo runs of whole games, shared out over worker threads (see batch)
+#define BATCH_MAX_TICKS 24000 // a game still going after ten minutes is cut short
+#define SURVIVAL_BUCKET 40 // steps per bucket of the survival histogram (one second)
+#define SURVIVAL_BUCKETS ( BATCH_MAX_TICKS / SURVIVAL_BUCKET + 1 )
+#define SCORE_BUCKETS 256 // the last also counts every higher score
+long batch_games = 0; // games to play, or 0 to play normally
+int worker_threads = 0; // workers for a batch or the bot's search, or 0 for one per processor
+int batch_level = 1;
 
-//
-#define LOOP_STEP 25
-timer_id global_timer;
+/*
+ * Type definition for the games one worker of a batch has played, and the session
+ * it plays them in. Totals are per worker, so workers never share a counter.
+ */
+typedef struct batch_worker{
+	game_session session;
+	game_bot bot; // chooses the keys under POLICY_BOT, searching on this worker alone
+	
+	long games;
+	long long ticks; // steps survived, over all games
+	long long score; // platforms landed on, over all games
+	long capped; // games cut short at BATCH_MAX_TICKS
+	unsigned long long hash; // sum of the final state hashes, which no order of games changes
+	long deaths[DEATH_CAUSES];
+	long survival[SURVIVAL_BUCKETS];
+	long scores[SCORE_BUCKETS];
+} batch_worker;
+
+// Attract mode: the bot plays the game, and carries on by itself where a player would press a key
+#define ATTRACT_PAUSE 1000 // milliseconds it waits instead
+bool bot_playing = false;
+game_bot bot; // also chooses the keys of --simulate under POLICY_BOT
+
+// The play area and the status text around it
+game_view view;
+
+// Session recording or playback
+replay_id replay;
+char* replay_file_name;
 
 // ----------------------------------------------------------------
 // Forward declarations of functions
 // ----------------------------------------------------------------
 void setup();
+void setup_round();
 void event_loop();
 void process_key( int key );
 void draw_all();
 void cleanup();
+void release_state();
 void wait_to_begin();
+int wait_for_key();
 void pause_for_exit();
 
 // Menu elements
-void draw_score();
-void draw_lives();
 void lose_life();
-void calculate_elapsed_time();
-void draw_time();
 void reset();
 void restart();
 void ask_to_restart();
 void change_level();
-void draw_level();
 void change_desired_speed();
-void change_speed();
-void draw_speed();
-void draw_border();
+
+// Recording and playback
+bool process_arguments( int argc, char* argv[] );
+void print_tick_stats();
+void print_frame_stats();
+
+// Simulation
+void simulate( long ticks );
+unsigned long long simulate_run( long ticks, timer_ns* phase_ns, int* deaths );
+void simulate_lap( simulate_clock* clock, int phase );
+void simulate_step_lap( void* context, int part );
+int policy_key( int policy, long tick, unsigned long long* rng );
+void batch( long games );
+void batch_game( void* context, long item, int worker );
+int histogram_percentile( long* counts, int buckets, long total, int percent );
 
 // ----------------------------------------------------------------
 // main function
 // ----------------------------------------------------------------
 
-int main( void ) {
-	srand( time( NULL ) ); 
+int main( int argc, char* argv[] ) {
+	if ( !process_arguments( argc, argv ) ){
+		return 1;
+	}
+	
+	if ( replay.mode == REPLAY_PLAYBACK ){
+		override_screen_size( replay.width, replay.height ); // play back with the recorded screen size
+	}
+	
+	if ( batch_games > 0 ){
+		batch( batch_games );
+		return 0;
+	}
+	
+	if ( !session_init( &game, replay.seed ) ){
+		fprintf( stderr, "Unable to allocate the game\n" );
+		return 1;
+	}
+	
+	if ( ( bot_playing || simulate_policy == POLICY_BOT ) 
+		&& !bot_init( &bot, worker_threads > 0 ? worker_threads : work_pool_threads() ) ){
+		fprintf( stderr, "Unable to allocate the bot\n" );
+		return 1;
+	}
+	
+	if ( simulate_ticks > 0 ){
+		simulate( simulate_ticks );
+		release_state();
+		return 0;
+	}
+	
 	setup();
+	scheduler_init( &scheduler, LOOP_STEP, MAX_CATCH_UP ); // restarted after every wait for a key
+	frame_stats_init( &frame, LOOP_STEP );
+	
+	if ( replay.mode == REPLAY_RECORD 
+		&& !replay_start_recording( &replay, replay_file_name, replay.seed, screen_width(), screen_height() ) ){
+		replay.mode = REPLAY_OFF;
+	}
+	
 	event_loop();
+	
+	unsigned long long hash = session_hash( &game );
+	bool match = replay_finish( &replay, hash );
 	cleanup();
+	
+	if ( replay.mode == REPLAY_RECORD ){
+		printf( "Recorded session %s (final state %016llx)\n", replay_file_name, hash );
+	} else if ( replay.mode == REPLAY_PLAYBACK ){
+		printf( "Replay of %s %s (final state %016llx)\n", replay_file_name, 
+				match ? "matches the recording" : "DIVERGED from the recording", hash );
+	}
+	
+	if ( show_stats ){
+		print_tick_stats();
+		print_frame_stats();
+	}
+	
+	if ( replay.mode == REPLAY_PLAYBACK && !match ){
+		return 2;
+	}
+	
 	return 0;
 }
 
 /*
- *	Set up the game. Sets the terminal to curses mode and places the player, platform, and boss.
+ * Reads command line options:
+ *	--record FILE	records the session to FILE
+ *	--replay FILE	plays back the session recorded in FILE
+ *	--fast			plays back as fast as possible, without pauses or drawing
+ *	--stats			reports how late simulation steps ran, and the time spent in each phase of the loop, on exit
+ *	--simulate N	runs N steps of each level at each speed flat out, and reports timings
+ *	--batch N		plays N whole games in all, shared out over the workers, and reports how long they lasted
+ *	--threads T		workers for --batch and the bot, rather than one per processor
+ *	--level L		level played by --batch
+ *	--policy P		keys pressed by --simulate and --batch: random (the default), script or bot
+ *	--bot			lets the bot play, without waiting for keys (attract mode)
+ *	--seed N		starts the session with random seed N rather than the time
+ * Returns false if the options are not valid.
  */
-
-void setup() {
-	setup_screen();
-	max_x = screen_width() - 1;
-	max_y = screen_height() - 1;
-	setup_player( player );
-	game_over = false;
-	player.score = 0;
-	setup_platform( platforms, NO_PLATFORMS, level );
-	setup_boss();
-	global_timer = create_timer( LOOP_STEP );
+bool process_arguments( int argc, char* argv[] ){
+	replay.mode = REPLAY_OFF;
+	replay.seed = time( NULL );
+	
+	for ( int i = 1; i < argc; i++ ){
+		if ( strcmp( argv[i], "--record" ) == 0 && i + 1 < argc ){
+			replay.mode = REPLAY_RECORD;
+			replay_file_name = argv[++i];
+		} else if ( strcmp( argv[i], "--replay" ) == 0 && i + 1 < argc ){
+			replay_file_name = argv[++i];
+			
+			if ( !replay_start_playback( &replay, replay_file_name ) ){
+				fprintf( stderr, "Unable to read replay file %s\n", replay_file_name );
+				return false;
+			}
+		} else if ( strcmp( argv[i], "--fast" ) == 0 ){
+			replay.fast = true;
+		} else if ( strcmp( argv[i], "--stats" ) == 0 ){
+			show_stats = true;
+		} else if ( strcmp( argv[i], "--simulate" ) == 0 && i + 1 < argc && atol( argv[i + 1] ) > 0 ){
+			simulate_ticks = atol( argv[++i] );
+		} else if ( strcmp( argv[i], "--batch" ) == 0 && i + 1 < argc && atol( argv[i + 1] ) > 0 ){
+			batch_games = atol( argv[++i] );
+		} else if ( strcmp( argv[i], "--threads" ) == 0 && i + 1 < argc && atoi( argv[i + 1] ) > 0 ){
+			worker_threads = atoi( argv[++i] );
+		} else if ( strcmp( argv[i], "--level" ) == 0 && i + 1 < argc 
+					&& atoi( argv[i + 1] ) >= 1 && atoi( argv[i + 1] ) <= MAX_LEVEL ){
+			batch_level = atoi( argv[++i] );
+		} else if ( strcmp( argv[i], "--policy" ) == 0 && i + 1 < argc && strcmp( argv[i + 1], "random" ) == 0 ){
+			simulate_policy = POLICY_RANDOM;
+			i++;
+		} else if ( strcmp( argv[i], "--policy" ) == 0 && i + 1 < argc && strcmp( argv[i + 1], "script" ) == 0 ){
+			simulate_policy = POLICY_SCRIPT;
+			i++;
+		} else if ( strcmp( argv[i], "--policy" ) == 0 && i + 1 < argc && strcmp( argv[i + 1], "bot" ) == 0 ){
+			simulate_policy = POLICY_BOT;
+			i++;
+		} else if ( strcmp( argv[i], "--bot" ) == 0 ){
+			bot_playing = true;
+		} else if ( strcmp( argv[i], "--seed" ) == 0 && i + 1 < argc && replay.mode != REPLAY_PLAYBACK ){
+			replay.seed = strtoull( argv[++i], NULL, 10 );
+		} else {
+			fprintf( stderr, "Usage: %s [--record FILE | --replay FILE [--fast]] [--seed N] [--stats]\n"
+							"       %s --bot [--threads T] [--seed N] [--stats]\n"
+							"       %s --simulate N [--policy random|script|bot] [--threads T] [--seed N]\n"
+							"       %s --batch N [--threads T] [--level L] [--policy random|script|bot] [--seed N]\n", 
+							argv[0], argv[0], argv[0], argv[0] );
+			return false;
+		}
+	}
+	
+	if ( bot_playing && replay.mode != REPLAY_OFF ){ // the bot's keys do not pass through the replay
+		fprintf( stderr, "--bot cannot be recorded or played back\n" );
+		return false;
+	}
+	
+	return true;
 }
 
-// ----------------------------------------------------------------
-// Player Functions
-// ----------------------------------------------------------------
-
-
 /*
- * Sets ups player
+ *	Set up the game. Sets the terminal to curses mode and places the player, platform, and boss.
  */
-void setup_player(){
-	static char * bitmap = 
-	"0"
-	"|"
-	"M";
-	
-	if ( player.player_sprite != NULL ){ // destroys sprite if it already has been initialized
-		sprite_destroy( player.player_sprite );
-	}
-	player.player_sprite = sprite_create( ( screen_width() - 1 ) / 2, screen_height() - 7, 1, 3, bitmap);
-	player.on_platform = true;
-	player.last_platform_hit = 0;
-	player.score = 0;
-	player.update_score = false;
+
+void setup() {
+	setup_screen();
+	setup_round();
 }
 
 /*
- * Sets up boss sprite. Clears previous boss sprites and bitmaps, if they exist.
+ * Places the player, platforms and boss for a new round. Needs no terminal, only a screen size.
  */
-void setup_boss(){
-	
-	if ( boss.sprite_boss != NULL ){ // clears memory from sprite and bitmaps
-		sprite_destroy( boss.sprite_boss );
-		clear_bitmaps( &boss );
-	}
-	boss.radius = rand_between( 5, 15 );
-	
-	create_directional_bitmaps( &boss );
-	
-	boss.sprite_boss = sprite_create( -2 * boss.radius, screen_height(), boss.radius * 2, 
-						boss.radius * 2, boss.bitmap_right );
-	boss.sprite_boss->dx = 0.1;
-	boss.sprite_boss->dy = ( -rand_between(1, 20) * 0.005 ); // boss moves in random diagonal direction
-	
-	boss.appear_delay = rand_between(130, 200);
-	boss.appear_delay_count = 0;
-	
-	boss.turn_delay = boss.appear_delay + rand_between( 140, 300 );
-	boss.turn_delay_count = 0;
-	boss.turn_total = 0;
+void setup_round() {
+	max_x = screen_width() - 1;
+	max_y = screen_height() - 1;
+	game_over = false;
+	session_setup_round( &game );
+	setup_view( &view, max_x, max_y );
 }
 
 /*
@@ -171,27 +313,52 @@ void event_loop() {
 	wait_to_begin();
 
 	while ( !game_over ) { // while game is not over, or lives is not at zero
-		int key = get_char();
-		bool player_changed = false;
-		bool platform_changed = false;
-		bool boss_changed = false;
+		timer_begin_frame(); // timers and the HUD clock all use this time until the next pass
+		frame_begin( &frame );
+		replay_next_tick( &replay );
+		
+		int key = replay_get_char( &replay );
+		bool changed = false;
 		
 		process_key( key );
 		
-		if ( timer_expired( global_timer ) ){
-			player_changed = process_player( &player, key, level, platforms, NO_PLATFORMS, boss);
-			platform_changed = process_platform( platforms, NO_PLATFORMS, level, speed );
-			boss_changed = process_boss( &boss, level );
+		if ( key != ERR ){
+			held_key = key; // keys arriving between steps act on the next one
 		}
 		
-		if ( player_changed || platform_changed || boss_changed ){
-			draw_all();
+		frame_lap( &frame, PHASE_INPUT );
+		int ticks = replay_ticks_due( &replay, &scheduler ); // more than one after a stall
+		
+		for ( int i = 0; i < ticks; i++ ){
+			int step_key = ( i == 0 ) ? held_key : ERR; // the key only acts on the first step
+			held_key = ERR;
+			
+			if ( bot_playing ){
+				step_key = bot_choose( &bot, &game ); // arrow keys from the terminal are ignored
+			}
+			
+			if ( session_step( &game, step_key ) ){
+				changed = true;
+			}
+		}
+		
+		frame_lap( &frame, PHASE_SIMULATION );
+		
+		if ( changed && !replay.fast ){
+			draw_game( &view, &game );
+			frame_lap( &frame, PHASE_DRAW );
+			show_screen();
+			frame_lap( &frame, PHASE_REFRESH );
 		}
 		
-		lose_life( lives ); // check if you need to lose a life
-		change_speed(); // changes speed if required
+		lose_life(); // check if you need to lose a life
+		frame_end( &frame, replay.fast ? 0 : scheduler.next_ns ); // the deadline waited for below
 		
-		timer_pause( 10 ); // gives cpu some time to catch it's breath
+		if ( replay.mode == REPLAY_PLAYBACK && !replay.fast ){
+			timer_sleep_until( scheduler.next_ns ); // keys come from the log
+		} else if ( !replay.fast ){
+			wait_input( scheduler.next_ns ); // sleeps until the next step, or until a key arrives
+		}
 		 
 	}
 	
@@ -208,8 +375,11 @@ void process_key( int key ){
 		reset();
 	} else if ( key == 'l' ){
 		change_level();
+	} else if ( key == 'd' ){
+		view.overlay = ( view.overlay == NULL ) ? &frame : NULL;
+		view.hud_valid = false; // redraws the borders
 	} else if ( ( key == '1' || key == '2' || key == '3' )
-				&& !speed_changing ){ // only processes if speed is not changing
+				&& game.speed == game.desired_speed ){ // only processes if speed is not changing
 		change_desired_speed( key );
 	}
 }
@@ -233,13 +403,13 @@ void reset(){
 void ask_to_restart(){
 	draw_formatted( 1, max_y / 2, "Game over! Press 'q' to quit, or any other key to restart." );
 	
-	int key = wait_char();
+	int key = wait_for_key();
 	
 	if ( key == 'q' ){
 		game_over = true;
 	} else {
-		lives = 3;
-		level = 1;
+		game.lives = START_LIVES;
+		game.level = 1;
 		reset();
 	}
 }
@@ -248,16 +418,7 @@ void ask_to_restart(){
  *	Redraws the screen
  */
 void draw_all() {
-	clear_screen();
-	draw_boss( boss );
-	draw_platforms( platforms, NO_PLATFORMS ); 
-	draw_player( player ); 
-	draw_score();
-	draw_lives();
-	draw_time();
-	draw_level();
-	draw_speed();
-	draw_border();
+	draw_game( &view, &game );
 	show_screen();
 } 
 
@@ -266,6 +427,15 @@ void draw_all() {
  */
 void cleanup() {
 	cleanup_screen();
+	release_state();
+}
+
+/*
+ * Frees the game's timers, platforms and sprites.
+ */
+void release_state() {
+	session_release( &game );
+	bot_release( &bot );
 }
 
 /*
@@ -273,152 +443,398 @@ void cleanup() {
  */
 void wait_to_begin(){
 	draw_formatted(0, 0, "Please press any key to begin");
-	wait_char();
-	start_time = get_current_time();
+	wait_for_key();
+	timer_begin_frame(); // the wait may have been long
+	view.start_time = get_frame_ns();
+	scheduler_restart( &scheduler ); // don't catch up on the time spent waiting
+	view.hud_valid = false; // message overwrote the lives
+}
+
+/*
+ * Waits for a key and returns it, or in attract mode pauses and returns ERR.
+ */
+int wait_for_key(){
+	frame_discard( &frame ); // the pass waiting is not timed
+	
+	if ( bot_playing ){
+		show_screen();
+		timer_pause( ATTRACT_PAUSE );
+		return ERR;
+	}
+	
+	return replay_wait_char( &replay );
 }
 
 /*
  *	Displays a messsage and waits for a keypress.
  */
 void pause_for_exit() {
-	draw_line( 0, max_y, max_x, max_y, ' ' );
+	draw_hline( 0, max_x, max_y, ' ' );
 	draw_string( 0, screen_height() - 1, "Press any key to exit..." );
-	wait_char();
+	replay_wait_char( &replay );
 }
 
 // ----------------------------------------------------------------
 // Menu elements
 // ----------------------------------------------------------------
 
-/*
- *	Draws score in bottom left corner
- */
-void draw_score() {
-	draw_line( 0, max_y, max_x, max_y, ' ' );
-	draw_formatted( 0, max_y, "Score: %d", player.score );
-}
-
-/*
- * Displays remaining lives.
- */
- void draw_lives() {
-	 draw_line( 0, 0, max_x, 0, ' ' );
-	 draw_formatted( 0, 0, "Remaining lives: %d", lives);
-}
-
 /*
  * Decrements lives, if player is not visible
  */
 void lose_life(){
-	if ( !player.player_sprite->is_visible && lives >= 0){
-		lives --;
-		draw_formatted(0, 0, "You have %d lives remaining! Press any key to reset.", lives );
-		wait_char();
+	if ( !game.player.player_sprite->is_visible && game.lives >= 0){
+		game.lives --;
+		draw_formatted(0, 0, "You have %d lives remaining! Press any key to reset.", game.lives );
+		wait_for_key();
 		reset();
-	} else if ( lives < 1 ){
+	} else if ( game.lives < 1 ){
 		ask_to_restart();
 	}
  }
 
-/*
- * Calculates and updats elapsed time in minutes and seconds
- */
-void calculate_elapsed_time(){
-	int elapsed_time = get_current_time() - start_time;
-	minutes = round( elapsed_time ) / 60;
-	seconds = elapsed_time % 60;
-}
-
-/*
- * updates and displays elapsed time 
- */
-void draw_time(){
-	calculate_elapsed_time();
-	draw_formatted(58, 0, "Time: %d:%d", minutes, seconds);
-}
-
 /*
  * Changes level.
  */
  void change_level(){
-	level = ( level % MAX_LEVEL ) + 1; // increments level (loops around when level gets to 3)
+	game.level = ( game.level % MAX_LEVEL ) + 1; // increments level (loops around when level gets to 3)
 	reset();
  }
  
  
- /*
-  * Draws level indicatior
-  */
- void draw_level(){
-	 draw_line( 0, max_y - 1, max_x, max_y - 1, ' ' );
-	 draw_formatted(0, max_y - 1, "Level %d", level);
- }
- 
 /*
- * Changes desired speed
+ * Changes desired speed. The game's speed moves towards it on each step (see session_ramp_speed).
  */
 void change_desired_speed( int key ){
 	switch( key ) {
 		case '1':
-			desired_speed = SLOW;
+			game.desired_speed = SLOW;
 			break;
 			
 		case '2':
-			desired_speed = NORMAL;
+			game.desired_speed = NORMAL;
 			break;
 			
 		case '3':
-			desired_speed = FAST;
+			game.desired_speed = FAST;
 			break;
 	}
 }
 
 /*
- * Changes speed to match desired speed.
- * Does so in a smooth manner
+ * Prints how late simulation steps ran relative to their deadlines. During playback
+ * steps come from the log, so the figures describe the pacing of the playback.
  */
-void change_speed(){	
-	if ( speed != desired_speed ){
-		speed_changing = true;
-		if ( speed > desired_speed ){
-			speed --; // decrement speed
-		} else{
-			speed ++; // increment speed
-		}
-	} else {
-		speed_changing = false;
+void print_tick_stats(){
+	tick_stats stats;
+	scheduler_stats( &scheduler, &stats );
+	printf( "Steps: %lld run, %lld dropped; late by %.3f ms mean, %.3f ms sd, %.3f-%.3f ms range\n",
+			stats.ticks, stats.dropped, stats.mean_ms, stats.sd_ms, stats.min_ms, stats.max_ms );
+}
+
+/*
+ * Prints the time spent in each phase of the passes of the event loop, and how many
+ * passes took longer than a step or woke late for the step they waited for. Passes
+ * which waited for a key are left out.
+ */
+void print_frame_stats(){
+	printf( "Passes: %lld timed, %lld took over %d ms, %lld woke over %d ms late\n",
+			frame.frames, frame.overruns, LOOP_STEP, frame.late, FRAME_LATE_MS );
+	printf( "%10s %8s %10s %10s %10s\n", "phase", "passes", "p50 us", "p99 us", "max us" );
+	
+	for ( int p = 0; p < FRAME_PHASES; p++ ){
+		phase_histogram* h = &frame.phases[p];
+		printf( "%10s %8lld %10.1f %10.1f %10.1f\n", phase_names[p], h->count, 
+				phase_percentile( h, 50 ) / 1e3, phase_percentile( h, 99 ) / 1e3, h->max_ns / 1e3 );
 	}
 }
 
+// ----------------------------------------------------------------
+// Simulation
+// ----------------------------------------------------------------
+
 /*
- * Draws speed in the bottom right corner
+ * Runs the simulation flat out, with no terminal, drawing or pauses, for ticks
+ * steps at each level and speed, with keys chosen by simulate_policy. A lost life
+ * starts a new round at once. For each run, prints the steps simulated per second,
+ * the time per step spent choosing keys and in each of process_player,
+ * process_platform and process_boss, the lives lost, and a hash of the final state.
+ *
+ * Runs depend only on the seed, the policy and ticks, so their hashes can be
+ * compared between builds. Each run is made twice: untimed for the rate, then
+ * reading the clock between subsystems for the breakdown. Both must end alike.
  */
-void draw_speed(){
-	if ( level == 3 ){ // only will activate if on level 3
-		switch( speed) {
-			case SLOW: 
-				draw_string( max_x - 12, max_y - 1, "Speed: SLOW" );
-				break;
+void simulate( long ticks ){
+	static const int speeds[] = { SLOW, NORMAL, FAST };
+	static const char* speed_names[] = { "SLOW", "NORMAL", "FAST" };
+	bool deterministic = true;
+	
+	override_screen_size( SIM_WIDTH, SIM_HEIGHT );
+	printf( "%ld steps per run, seed %llu, %s keys\n", ticks, replay.seed, policy_names[simulate_policy] );
+	printf( "%5s %6s %12s %8s %8s %9s %9s %9s %6s %16s\n", "level", "speed", "steps/s", "x real",
+			"keys ns", "player ns", "plats ns", "boss ns", "deaths", "state" );
+	
+	for ( int l = 1; l <= MAX_LEVEL; l++ ){
+		for ( int s = 0; s < 3; s++ ){
+			timer_ns phase_ns[SIM_PHASES] = { 0 };
+			int deaths;
+			
+			game.level = l;
+			game.speed = game.desired_speed = speeds[s];
+			
+			timer_ns start = get_host_ns();
+			unsigned long long hash = simulate_run( ticks, NULL, &deaths );
+			double elapsed = (double) ( get_host_ns() - start ) / NANOSECONDS;
 			
-			case NORMAL: 
-				draw_string( max_x - 12, max_y - 1, "Speed: NORM" );
-				break;
-				
-			case FAST: 
-				draw_string( max_x - 12, max_y - 1, "Speed: FAST" );
-				break;
+			if ( simulate_run( ticks, phase_ns, &deaths ) != hash ){
+				deterministic = false;
+			}
 			
-			default:
-				draw_string( max_x - 12, max_y - 1, "Changing..." );
-				break;
+			double rate = ticks / elapsed;
+			printf( "%5d %6s %12.0f %8.0f %8.1f %9.1f %9.1f %9.1f %6d %016llx\n", l, speed_names[s], rate,
+					rate * LOOP_STEP / MILLISECONDS, (double) phase_ns[SIM_KEYS] / ticks, 
+					(double) phase_ns[SIM_PLAYER] / ticks, (double) phase_ns[SIM_PLATFORMS] / ticks, 
+					(double) phase_ns[SIM_BOSS] / ticks, deaths, hash );
 		}
 	}
+	
+	if ( !deterministic ){
+		printf( "Timed and untimed runs DIVERGED\n" );
+	}
 }
- 
- /*
-  * Draws border at top and bottom of screen.
-  */
-void draw_border(){
-	draw_line( 0, 1, max_x, 1, '-' );
-	draw_line( 0, max_y - 2, max_x, max_y - 2, '-' );
+
+/*
+ * Runs one round of the simulation from the seed for ticks steps, at the current level
+ * and speed. If phase_ns is not NULL, adds the time spent in each part of a step to it.
+ * Reports the number of lives lost, and returns the hash of the final state.
+ */
+unsigned long long simulate_run( long ticks, timer_ns* phase_ns, int* deaths ){
+	unsigned long long rng = replay.seed ^ 0x9E3779B97F4A7C15ULL; // keys use their own generator, apart from the game's
+	
+	rng_seed( &game.rng, replay.seed );
+	setup_round();
+	*deaths = 0;
+	
+	simulate_clock clock = { phase_ns, ( phase_ns != NULL ) ? get_host_ns() : 0 };
+	
+	for ( long t = 0; t < ticks; t++ ){
+		int key = ( simulate_policy == POLICY_BOT ) ? bot_choose( &bot, &game ) : policy_key( simulate_policy, t, &rng );
+		simulate_lap( &clock, SIM_KEYS );
+		
+		session_step_timed( &game, key, ( phase_ns != NULL ) ? simulate_step_lap : NULL, &clock );
+		
+		if ( !game.player.player_sprite->is_visible ){
+			( *deaths )++;
+			setup_round();
+			clock.last = ( phase_ns != NULL ) ? get_host_ns() : 0; // a new round is not part of any step
+		}
+	}
+	
+	return session_hash( &game );
+}
+
+/*
+ * Adds the time since the last lap to phase, unless the run is not timed.
+ */
+void simulate_lap( simulate_clock* clock, int phase ){
+	if ( clock->phase_ns != NULL ){
+		timer_ns now = get_host_ns();
+		clock->phase_ns[phase] += now - clock->last;
+		clock->last = now;
+	}
+}
+
+/*
+ * Laps the clock of a simulation run (context) as a part of session_step ends.
+ */
+void simulate_step_lap( void* context, int part ){
+	simulate_lap( context, SIM_PLAYER + part );
+}
+
+/*
+ * Chooses the key pressed on a simulated step: under POLICY_RANDOM, a random arrow
+ * on one step in eight, and under POLICY_SCRIPT, the next of a fixed sequence every
+ * 20 steps (half a second). Returns ERR on the other steps.
+ */
+int policy_key( int policy, long tick, unsigned long long* rng ){
+	static const int script[] = { KEY_LEFT, KEY_UP, KEY_RIGHT, KEY_RIGHT, KEY_UP, KEY_LEFT, KEY_DOWN, KEY_UP };
+	static const int arrows[] = { KEY_LEFT, KEY_RIGHT, KEY_UP, KEY_DOWN };
+	
+	if ( policy == POLICY_SCRIPT ){
+		return ( tick % 20 == 0 ) ? script[( tick / 20 ) % 8] : ERR;
+	}
+	
+	*rng ^= *rng << 13; // xorshift64
+	*rng ^= *rng >> 7;
+	*rng ^= *rng << 17;
+	
+	int bits = *rng >> 59; // top five bits
+	return ( bits & 7 ) == 0 ? arrows[bits >> 3] : ERR;
+}
+
+// ----------------------------------------------------------------
+// Batch simulation
+// ----------------------------------------------------------------
+
+/*
+ * Plays whole games of batch_level flat out, as many in all as games, shared out over
+ * worker_threads workers (or one per processor), with keys chosen by simulate_policy.
+ * Reports the distributions of how long they lasted, their scores and what killed the
+ * player. Game i has random seed seed + i, and runs at normal speed until its lives
+ * are lost or BATCH_MAX_TICKS steps pass.
+ *
+ * A game depends only on its seed, so the figures and the combined state hash are
+ * the same for any number of threads.
+ */
+void batch( long games ){
+	static const char* death_names[DEATH_CAUSES] = { "", "fell", "top", "unsafe", "boss" };
+	int threads = ( worker_threads > 0 ) ? worker_threads : work_pool_threads();
+	batch_worker* workers = calloc( threads, sizeof( batch_worker ) );
+	bool allocated = workers != NULL;
+	
+	override_screen_size( SIM_WIDTH, SIM_HEIGHT );
+	
+	for ( int i = 0; i < threads && allocated; i++ ){
+		allocated = session_init( &workers[i].session, 0 ) 
+					&& ( simulate_policy != POLICY_BOT || bot_init( &workers[i].bot, 1 ) );
+	}
+	
+	if ( !allocated ){
+		fprintf( stderr, "Unable to allocate the games\n" );
+		
+		for ( int i = 0; i < threads && workers != NULL; i++ ){
+			session_release( &workers[i].session ); // harmless on sessions never set up
+			bot_release( &workers[i].bot );
+		}
+		free( workers );
+		return;
+	}
+	
+	long steals = 0;
+	timer_ns start = get_host_ns();
+	work_pool_run( games, threads, batch_game, workers, &steals );
+	double elapsed = (double) ( get_host_ns() - start ) / NANOSECONDS;
+	
+	batch_worker* total = &workers[0]; // the others are added to worker 0
+	
+	for ( int i = 1; i < threads; i++ ){
+		batch_worker* w = &workers[i];
+		total->games += w->games;
+		total->ticks += w->ticks;
+		total->score += w->score;
+		total->capped += w->capped;
+		total->hash += w->hash;
+		
+		for ( int d = 0; d < DEATH_CAUSES; d++ ){
+			total->deaths[d] += w->deaths[d];
+		}
+		for ( int b = 0; b < SURVIVAL_BUCKETS; b++ ){
+			total->survival[b] += w->survival[b];
+		}
+		for ( int b = 0; b < SCORE_BUCKETS; b++ ){
+			total->scores[b] += w->scores[b];
+		}
+	}
+	
+	long deaths = 0;
+	
+	for ( int d = 1; d < DEATH_CAUSES; d++ ){
+		deaths += total->deaths[d];
+	}
+	
+	printf( "%ld games of level %d from seed %llu, %s keys, %d threads (%ld steals)\n", games, batch_level, 
+			replay.seed, policy_names[simulate_policy], threads, steals );
+	printf( "%.0f games/s, %.0f steps/s\n", games / elapsed, total->ticks / elapsed );
+	printf( "Survival: mean %.1f s, p10 %d s, p50 %d s, p90 %d s; %ld games cut short at %d s\n", 
+			(double) total->ticks / games * LOOP_STEP / MILLISECONDS,
+			histogram_percentile( total->survival, SURVIVAL_BUCKETS, games, 10 ),
+			histogram_percentile( total->survival, SURVIVAL_BUCKETS, games, 50 ),
+			histogram_percentile( total->survival, SURVIVAL_BUCKETS, games, 90 ),
+			total->capped, BATCH_MAX_TICKS / SURVIVAL_BUCKET );
+	printf( "Score: mean %.2f, p10 %d, p50 %d, p90 %d\n", (double) total->score / games,
+			histogram_percentile( total->scores, SCORE_BUCKETS, games, 10 ),
+			histogram_percentile( total->scores, SCORE_BUCKETS, games, 50 ),
+			histogram_percentile( total->scores, SCORE_BUCKETS, games, 90 ) );
+	printf( "Deaths:" );
+	
+	for ( int d = 1; d < DEATH_CAUSES; d++ ){
+		printf( " %s %.1f%%", death_names[d], deaths > 0 ? 100.0 * total->deaths[d] / deaths : 0.0 );
+	}
+	
+	printf( "\nState %016llx\n", total->hash );
+	
+	for ( int i = 0; i < threads; i++ ){
+		session_release( &workers[i].session );
+		bot_release( &workers[i].bot );
+	}
+	free( workers );
+}
+
+/*
+ * Plays game number item of a batch, in the session of the worker running it,
+ * and adds it to the worker's totals. Run by work_pool_run.
+ */
+void batch_game( void* context, long item, int worker ){
+	batch_worker* w = &( (batch_worker*) context )[worker];
+	game_session* session = &w->session;
+	unsigned long long seed = replay.seed + item;
+	game_rng mixer; // spreads out the key generators of neighbouring seeds
+	
+	rng_seed( &mixer, seed ^ 0x9E3779B97F4A7C15ULL );
+	unsigned long long keys = rng_next( &mixer ) | 1; // xorshift must not start from zero
+	
+	rng_seed( &session->rng, seed );
+	session->level = batch_level;
+	session->lives = START_LIVES;
+	session->speed = NORMAL;
+	session->desired_speed = NORMAL;
+	session_setup_round( session );
+	
+	long t = 0;
+	int score = 0;
+	
+	while ( session->lives > 0 && t < BATCH_MAX_TICKS ){
+		int key = ( simulate_policy == POLICY_BOT ) ? bot_choose( &w->bot, session ) : policy_key( simulate_policy, t, &keys );
+		session_step( session, key );
+		t++;
+		
+		if ( !session->player.player_sprite->is_visible ){
+			w->deaths[session->player.death]++;
+			score += session->player.score;
+			session->lives--;
+			
+			if ( session->lives > 0 ){
+				session_setup_round( session );
+			}
+		}
+	}
+	
+	if ( session->lives > 0 ){ // still playing
+		score += session->player.score;
+		w->capped++;
+	}
+	
+	w->games++;
+	w->ticks += t;
+	w->score += score;
+	w->hash += session_hash( session );
+	w->survival[t / SURVIVAL_BUCKET]++;
+	w->scores[score < SCORE_BUCKETS ? score : SCORE_BUCKETS - 1]++;
+}
+
+/*
+ * Returns the first bucket of a histogram holding total counts by which at least
+ * percent percent of them have been counted.
+ */
+int histogram_percentile( long* counts, int buckets, long total, int percent ){
+	long seen = 0;
+	
+	for ( int b = 0; b < buckets; b++ ){
+		seen += counts[b];
+		
+		if ( seen * 100 >= total * percent ){
+			return b;
+		}
+	}
+	
+	return buckets - 1;
 }
\ No newline at end of file
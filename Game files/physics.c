@@ -0,0 +1,21 @@
+#include "physics.h"
+
+// ----------------------------------------------------------------
+// Body functions
+// ----------------------------------------------------------------
+
+/*
+ * Moves a body one step, as sprite_step does for a sprite.
+ */
+void body_step( body* b ){
+	b->x += b->dx;
+	b->y += b->dy;
+}
+
+/*
+ * Moves and turns a sprite to match a body.
+ */
+void body_to_sprite( body* b, sprite_id sprite ){
+	sprite_move_to( sprite, num_to_double( b->x ), num_to_double( b->y ) );
+	sprite_turn_to( sprite, num_to_double( b->dx ), num_to_double( b->dy ) );
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef __PHYSICS_H__
+#define __PHYSICS_H__
+
+#include <math.h>
+#include "cab202_sprites.h"
+
+/*
+ * Number type used for positions and velocities.
+ *
+ * By default the simulation uses double. Built with -DFIXED_PHYSICS
+ * ("make PHYSICS=fixed"), it uses Q16.16 fixed point from cab202_fixed.h
+ * instead, so a session gives bit-exact results whatever the compiler or
+ * flags, and positions take 4 bytes rather than 8. Sessions recorded by
+ * one kind of build only replay exactly on the same kind.
+ *
+ * Code written with these macros computes exactly what the plain double
+ * code did when FIXED_PHYSICS is not defined.
+ */
+#ifdef FIXED_PHYSICS
+
+#include "cab202_fixed.h"
+
+typedef fixed num;
+
+#define NUM(c) FIXED( c ) // constant
+#define NUM_INT(i) fixed_from_int( i )
+#define num_mul(a, b) fixed_mul( a, b )
+#define num_round(a) fixed_round( a ) // nearest int, halves away from zero
+#define num_trunc(a) fixed_trunc( a ) // int, toward zero
+#define num_floor(a) ( ( a ) >> FIXED_SHIFT ) // int, toward minus infinity
+#define num_hypot(dx, dy) fixed_hypot( dx, dy )
+#define num_sin_deg(d) fixed_sin_deg( d )
+#define num_cos_deg(d) fixed_cos_deg( d )
+#define num_to_double(a) fixed_to_double( a )
+
+#else
+
+typedef double num;
+
+#define NUM(c) ( c )
+#define NUM_INT(i) ( (double) ( i ) )
+#define num_mul(a, b) ( ( a ) * ( b ) )
+#define num_round(a) ( (int) round( a ) )
+#define num_trunc(a) ( (int) ( a ) )
+#define num_floor(a) ( (int) ( a ) - ( ( a ) < (int) ( a ) ) ) // branch-free, unlike floor
+#define num_hypot(dx, dy) sqrt( ( ( dx ) * ( dx ) ) + ( ( dy ) * ( dy ) ) )
+#define num_sin_deg(d) sin( ( d ) * M_PI / 180 )
+#define num_cos_deg(d) cos( ( d ) * M_PI / 180 )
+#define num_to_double(a) ( a )
+
+#endif
+
+/*
+ * Position and step of a moving object. The sprite showing the object
+ * is moved to match before it is drawn.
+ */
+typedef struct body{
+	num x, y; // location (top left corner)
+	num dx, dy; // step taken each time the body moves
+} body;
+
+// ----------------------------------------------------------------
+// Forward declaration of functions
+// ----------------------------------------------------------------
+void body_step( body* b );
+void body_to_sprite( body* b, sprite_id sprite );
+
+#endif
\ No newline at end of file
@@ -0,0 +1,454 @@
+#include <stdlib.h>
+#include <string.h>
+#include "cab202_graphics.h"
+#include "platforms.h"
+
+// ----------------------------------------------------------------
+// Platform functions
+// ----------------------------------------------------------------
+
+/*
+ * Starts the generator from seed.
+ */
+void rng_seed( game_rng* rng, unsigned long long seed ){
+	rng->state = seed;
+}
+
+/*
+ * Gets the next 64 random bits.
+ */
+unsigned long long rng_next( game_rng* rng ){
+	unsigned long long z = ( rng->state += 0x9E3779B97F4A7C15ULL );
+	z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+	z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+	return z ^ ( z >> 31 );
+}
+
+/*
+ *	Gets a random integer that is greater than or equal to
+ *	first and less than last.
+ *	Precondition: first < last;
+ */
+int rand_between( game_rng* rng, int first, int last ) {
+	return first + (int) ( rng_next( rng ) % (unsigned) ( last - first ) );
+}
+
+/*
+ * Allocates the arrays for count platforms. Returns false if memory could not be allocated.
+ */
+bool platform_store_init( platform_store* store, int count ){
+	store->count = count;
+	store->x = calloc( count, sizeof( num ) );
+	store->y = calloc( count, sizeof( num ) );
+	store->dy = calloc( count, sizeof( num ) );
+	store->width = calloc( count, sizeof( int ) );
+	store->spawn_id = calloc( count, sizeof( int ) );
+	store->safe = calloc( count, sizeof( bool ) );
+	store->is_visible = calloc( count, sizeof( int ) );
+	store->drawn = calloc( count, sizeof( screen_rect ) );
+	store->changed = calloc( ( count + 63 ) / 64, sizeof( unsigned long long ) );
+
+	if ( store->x == NULL || store->y == NULL || store->dy == NULL || store->width == NULL
+		|| store->spawn_id == NULL || store->safe == NULL || store->is_visible == NULL
+		|| store->drawn == NULL || store->changed == NULL ){
+		platform_store_release( store );
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Frees the arrays of a platform store.
+ */
+void platform_store_release( platform_store* store ){
+	free( store->x );
+	free( store->y );
+	free( store->dy );
+	free( store->width );
+	free( store->spawn_id );
+	free( store->safe );
+	free( store->is_visible );
+	free( store->drawn );
+	free( store->changed );
+	memset( store, 0, sizeof( platform_store ) );
+}
+
+/*
+ * Sets up platform positions.
+ * randomly assigns a safety condition to each platform.
+ */
+void setup_platform( platform_store* store, int level, game_rng* rng ) {
+
+	initialize_platforms( store, rng );
+
+	for ( int i = 0; i < store->count; i++ ) {
+		store->spawn_id[i] = i;
+	}
+
+	for ( int i = 1; i < store->count; i++ ) { // starts looping at second platform
+		if( i%2 == 0 ){ // if platform is even
+			spawn_next( store, i-1, i, rng ); // spawns platform next to previous platform
+		} else {
+			spawn_under( store, i-1, i, rng ); // spawns platform next to previous platform
+		}
+		store->safe[i] = ( rand_between( rng, 0, 20 ) ) < 13; // probability of safe platform = 6/10
+	}
+}
+
+/*
+ * Starts a ring over platforms just set up by setup_platform.
+ */
+void setup_ring( platform_ring* ring, int no_plats ){
+	ring->oldest = 0;
+	ring->spawned = no_plats;
+}
+
+/*
+ * Reuses the slots of platforms which have scrolled off the top of the screen,
+ * spawning new platforms at the bottom of the chain.
+ * Returns true if any platform was spawned.
+ */
+bool recycle_platforms( platform_ring* ring, platform_store* store, platform_grid* grid, game_rng* rng ){
+	bool recycled = false;
+	int no_plats = store->count;
+
+	while ( !store->is_visible[ring->oldest] ){ // stops after at most no_plats, as each respawned platform is visible
+		int i = ring->oldest;
+		int newest = ( i + no_plats - 1 ) % no_plats;
+
+		respawn_platform( store, i, newest, ring->spawned, rng );
+		grid_update( grid, i );
+
+		ring->spawned++;
+		ring->oldest = ( i + 1 ) % no_plats;
+		recycled = true;
+	}
+
+	return recycled;
+}
+
+/*
+ * Places platform i after the newest one, by the same rules as setup_platform,
+ * and no higher than the bottom of the screen.
+ */
+void respawn_platform( platform_store* store, int i, int newest, int spawn_id, game_rng* rng ){
+	store->width[i] = rand_between( rng, 5, 10 );
+	store->dy[i] = NUM( BASE_DY );
+
+	if ( spawn_id % 2 == 0 ){
+		spawn_next( store, newest, i, rng );
+	} else {
+		spawn_under( store, newest, i, rng );
+	}
+
+	if ( store->y[i] < NUM_INT( screen_height() ) ){ // appears from below the screen
+		store->y[i] = NUM_INT( screen_height() );
+	}
+
+	store->safe[i] = ( rand_between( rng, 0, 20 ) ) < 13;
+	store->is_visible[i] = true;
+	store->spawn_id[i] = spawn_id;
+}
+
+/*
+ * Initialises all platforms.
+ * Picks a random width, safe to true
+ * Position is initially set to the bottom of the screen, in the center.
+ */
+void initialize_platforms( platform_store* store, game_rng* rng ){
+	for ( int i = 0; i < store->count; i++ ) {
+		store->safe[i] = true;
+		store->is_visible[i] = true;
+		store->width[i] = rand_between( rng, 5, 10 ); // sets random width between 5-10 characters
+
+		int x = (( screen_width() - 1) / 2 ) - ( store->width[i] / 2); // Sets x position to middle of screen
+		int y = screen_height() - 4;
+
+		store->x[i] = NUM_INT( x );
+		store->y[i] = NUM_INT( y );
+		store->dy[i] = NUM( BASE_DY );
+	}
+}
+
+
+/*
+ * Sets position of platform i.
+ * creates random y position that is between 5 and 10 spaces below platform from
+ * x position is random, but cannot exceed the screen width - platform width
+ */
+void spawn_under( platform_store* store, int from, int i, game_rng* rng ){
+	int y0 = num_round( store->y[from] );
+
+	int x = rand_between( rng, 0, screen_width() - store->width[i] ); // offsets x position depending on first platform
+
+	store->x[i] = NUM_INT( x );
+	store->y[i] = NUM_INT( rand_between( rng, y0 + 5, y0 + 10 ) ); // creates a random y position between plat1.y and 5
+}
+
+void spawn_next( platform_store* store, int from, int i, game_rng* rng ){
+	int threshold = screen_width() - ( store->width[from] + store->width[i]); // number of spaces the platform can occupy
+
+	int offset = rand_between( rng, 4, threshold );
+
+	store->x[i] = NUM_INT( num_trunc( store->x[from] + NUM_INT( store->width[from] ) + NUM_INT( offset ) ) % ( screen_width() - 1 ) ); // x position will wrap around;
+	store->y[i] = store->y[from] + NUM_INT( rand_between( rng, 0, 6 ) );
+}
+
+/*
+ * Moves the platforms; returns true if any platform moved to another row, and false otherwise
+ */
+bool process_platform( platform_store* store, int level, int speed, platform_grid* grid ) {
+	bool platform_moved;
+
+	if ( level == 1 || level == 2 ){
+		platform_moved = platform_step_all( store, NUM( BASE_DY ), 0 ); // constant speed
+	} else {
+		platform_moved = platform_step_all( store, 0, speed ); // speed multiplier taken into consideration
+	}
+
+	// Only platforms which changed row can have changed cell, or become invisible.
+	for ( int w = 0; platform_moved && w < ( store->count + 63 ) / 64; w++ ){
+		for ( unsigned long long bits = store->changed[w]; bits != 0; bits &= bits - 1 ){
+			grid_update( grid, w * 64 + __builtin_ctzll( bits ) ); // refiles the platform if it changed cells
+		}
+	}
+
+	return platform_moved;
+}
+
+/*
+ * Moves every visible platform up by base plus its dy scaled by speed and
+ * SPEED_MULTIPLIER, hides those which reach the top of the screen, and records
+ * in store->changed which ones moved to another row.
+ *
+ * Each block of 64 platforms is stepped in one branch-free loop over the arrays,
+ * which the compiler can vectorise, then its row changes are packed into a word.
+ * A platform is hidden once its row is above -3, which is when y < -3.
+ * Returns true if any platform changed row.
+ */
+bool platform_step_all( platform_store* store, num base, int speed ){
+	bool any_changed = false;
+
+	for ( int first = 0; first < store->count; first += 64 ){
+		int n = store->count - first < 64 ? store->count - first : 64;
+		num* restrict y = store->y + first; // the arrays never overlap
+		num* restrict dy = store->dy + first;
+		int* restrict visible = store->is_visible + first;
+		int moved[64];
+
+		for ( int i = 0; i < n; i++ ){ // & rather than &&, which would branch
+			int v = visible[i];
+			num step = base + num_mul( dy[i] * speed, NUM( SPEED_MULTIPLIER ) );
+			int row0 = platform_row( y[i] );
+			int row1 = platform_row( y[i] + step );
+
+			y[i] += v * step; // only visible platforms move
+			moved[i] = v & ( row1 != row0 );
+			visible[i] = v & ( row1 >= -3 ); // becomes invisible at the top of the screen
+		}
+
+		unsigned long long bits = 0;
+
+		for ( int i = 0; i < n; i++ ){
+			bits |= (unsigned long long) moved[i] << i;
+		}
+
+		store->changed[first / 64] = bits;
+		any_changed = any_changed || bits != 0;
+	}
+
+	return any_changed;
+}
+
+
+/*
+ *	Draws the platforms.
+ */
+void draw_platforms( platform_store* store ) {
+	for ( int i = 0; i < store->count; i++ ) {
+		if ( store->is_visible[i] ){
+			draw_single_platform( store, i );
+		} else {
+			mark_dirty_move( &(store->drawn[i]), 0, 0, 0, 0 ); // erases platform from its last position
+		}
+	}
+}
+
+/*
+ * Draws a single platform, and reports the area it covers.
+ */
+void draw_single_platform( platform_store* store, int i ){
+	char character;
+
+	if ( store->safe[i] ){
+		character = '=';
+	} else {
+		character = 'x';
+	}
+
+	int x = num_trunc( store->x[i] );
+	int y = num_trunc( store->y[i] );
+	int width = store->width[i];
+
+	mark_dirty_move( &(store->drawn[i]), x, y, width + 1, 2 );
+
+	draw_hline( x, x + width, y, character );
+	draw_hline( x, x + width, y + 1, character );
+}
+
+// ----------------------------------------------------------------
+// Platform index functions
+// ----------------------------------------------------------------
+
+/*
+ * Allocates an index for up to no_plats platforms. Returns false if memory could not be allocated.
+ */
+bool grid_init( platform_grid* grid, int no_plats ){
+	grid->bucket_count = 64;
+	while ( grid->bucket_count < no_plats ){
+		grid->bucket_count *= 2;
+	}
+
+	grid->store = NULL;
+	grid->max_width = 0;
+	grid->buckets = malloc( grid->bucket_count * sizeof( int ) );
+	grid->next = malloc( no_plats * sizeof( int ) );
+	grid->prev = malloc( no_plats * sizeof( int ) );
+	grid->cell_x = malloc( no_plats * sizeof( int ) );
+	grid->cell_y = malloc( no_plats * sizeof( int ) );
+	grid->filed = calloc( no_plats, sizeof( bool ) );
+
+	if ( grid->buckets == NULL || grid->next == NULL || grid->prev == NULL
+		|| grid->cell_x == NULL || grid->cell_y == NULL || grid->filed == NULL ){
+		grid_release( grid );
+		return false;
+	}
+
+	memset( grid->buckets, -1, grid->bucket_count * sizeof( int ) );
+	return true;
+}
+
+/*
+ * Frees the memory used by an index.
+ */
+void grid_release( platform_grid* grid ){
+	free( grid->buckets );
+	free( grid->next );
+	free( grid->prev );
+	free( grid->cell_x );
+	free( grid->cell_y );
+	free( grid->filed );
+	memset( grid, 0, sizeof( platform_grid ) );
+}
+
+/*
+ * Files every visible platform afresh. Call after the platforms are set up.
+ */
+void grid_build( platform_grid* grid, platform_store* store ){
+	grid->store = store;
+	grid->max_width = 0;
+	memset( grid->buckets, -1, grid->bucket_count * sizeof( int ) );
+	memset( grid->filed, 0, store->count * sizeof( bool ) );
+
+	for ( int i = 0; i < store->count; i++ ){
+		grid_update( grid, i );
+	}
+}
+
+/*
+ * Brings the index up to date with platform i: files it under the cell it
+ * now occupies, or removes it if it is no longer visible.
+ */
+void grid_update( platform_grid* grid, int i ){
+	platform_store* store = grid->store;
+	int cx = grid_cell( store->x[i], GRID_CELL_W );
+	int cy = grid_cell( store->y[i], GRID_CELL_H );
+
+	if ( grid->filed[i] ){
+		if ( store->is_visible[i] && grid->cell_x[i] == cx && grid->cell_y[i] == cy ){
+			return; // still in the same cell
+		}
+		grid_unlink( grid, i );
+	}
+
+	if ( !store->is_visible[i] ){
+		return;
+	}
+
+	int bucket = grid_bucket( grid, cx, cy );
+
+	if ( store->width[i] > grid->max_width ){ // widens the area searched by grid_find
+		grid->max_width = store->width[i];
+	}
+
+	grid->cell_x[i] = cx;
+	grid->cell_y[i] = cy;
+	grid->filed[i] = true;
+	grid->prev[i] = -1;
+	grid->next[i] = grid->buckets[bucket];
+	if ( grid->next[i] >= 0 ){
+		grid->prev[grid->next[i]] = i;
+	}
+	grid->buckets[bucket] = i;
+}
+
+/*
+ * Finds the lowest-numbered visible platform for which touches( store, platform, x, y )
+ * is true, out of those with their top left corner within max_width + 1
+ * columns left of and 1 column right of x, and 1 row above and 3 rows below y.
+ * Returns its index, or -1 if there is none.
+ */
+int grid_find( platform_grid* grid, num x, num y, bool ( *touches )( platform_store* store, int i, num x, num y ) ){
+	int cx0 = grid_cell( x - NUM_INT( grid->max_width + 1 ), GRID_CELL_W );
+	int cx1 = grid_cell( x + NUM_INT( 1 ), GRID_CELL_W );
+	int cy0 = grid_cell( y - NUM_INT( 1 ), GRID_CELL_H );
+	int cy1 = grid_cell( y + NUM_INT( 3 ), GRID_CELL_H );
+	int found = -1;
+
+	for ( int cy = cy0; cy <= cy1; cy++ ){
+		for ( int cx = cx0; cx <= cx1; cx++ ){
+			for ( int i = grid->buckets[grid_bucket( grid, cx, cy )]; i >= 0; i = grid->next[i] ){
+				if ( grid->cell_x[i] == cx && grid->cell_y[i] == cy // other cells may share the bucket
+					&& ( found < 0 || i < found ) && touches( grid->store, i, x, y ) ){
+					found = i;
+				}
+			}
+		}
+	}
+
+	return found;
+}
+
+/*
+ * Gets the cell holding a position, rounding down.
+ */
+int grid_cell( num position, int size ){
+	int row = num_floor( position );
+	return row >= 0 ? row / size : -( ( size - 1 - row ) / size );
+}
+
+/*
+ * Gets the bucket a cell hashes to.
+ */
+int grid_bucket( platform_grid* grid, int cx, int cy ){
+	unsigned hash = (unsigned) cx * 73856093u ^ (unsigned) cy * 19349663u;
+	return hash & ( grid->bucket_count - 1 );
+}
+
+/*
+ * Takes platform i out of its bucket.
+ */
+void grid_unlink( platform_grid* grid, int i ){
+	int bucket = grid_bucket( grid, grid->cell_x[i], grid->cell_y[i] );
+
+	if ( grid->prev[i] >= 0 ){
+		grid->next[grid->prev[i]] = grid->next[i];
+	} else {
+		grid->buckets[bucket] = grid->next[i];
+	}
+	if ( grid->next[i] >= 0 ){
+		grid->prev[grid->next[i]] = grid->prev[i];
+	}
+	grid->filed[i] = false;
+}
\ No newline at end of file
@@ -1,190 +1,127 @@
+#ifndef __PLATFORMS_H__
+#define __PLATFORMS_H__
+
+#include <stdbool.h>
+#include "cab202_graphics.h"
+#include "physics.h"
+
 #define BASE_DY -0.07
 #define TIMESTEP 0.01
 #define SPEED_MULTIPLIER 0.01
 
 /*
- * Type definition for a platform.
- */
-typedef struct platform{
-	double x; // x position (top left corner)
-	double y; // y position (top left corner)
-	double dy; // change in y position
-	
-	bool safe; // is platform safe;
-	bool is_visible; // is platform visible
-	
-	int width; // platform width
-} platform;
-
-
-// ----------------------------------------------------------------
-// Forward declaration of functions
-// ----------------------------------------------------------------
-int rand_between( int first, int last );
-void setup_platform( platform*plat, int no_plats, int level);
-void initialize_platforms( platform* plat, int no_plats );
-void spawn_under( platform plat1, platform* plat2 );
-void spawn_next( platform plat1, platform* plat2 );
-bool process_platform( platform*plat, int no_plats, int level, double speed );
-void draw_platforms( platform*plat, int no_plats );
-void draw_single_platform( platform plat );
-void platform_fall( platform* plat, int level, double speed );
-void platform_fall_NG( platform* plat );
-void platform_fall_G( platform* plat, int speed );
-
-// ----------------------------------------------------------------
-// Platform functions
-// ----------------------------------------------------------------
-
-/*
- *	Gets a random integer that is greater than or equal to
- *	first and less than last.
- *	Precondition: first < last;
- */
-int rand_between( int first, int last ) {
-	return first + rand() % ( last - first );
-}
-
-/*
- * Sets up platform positions.
- * randomly assigns a safety condition to each platform.
- */
-void setup_platform( platform* plat, int no_plats, int level ) {
-	
-	initialize_platforms( plat, no_plats );
-
-	for ( int i = 1; i < no_plats; i++ ) { // starts looping at second platform
-		if( i%2 == 0 ){ // if platform is even
-			spawn_next( plat[i-1], &(plat[i]) ); // spawns platform next to previous platform
-		} else {
-			spawn_under( plat[i-1], &(plat[i]) ); // spawns platform next to previous platform
-		}
-		plat[i].safe = ( rand_between( 0, 20 ) ) < 13; // probability of safe platform = 6/10
-	}
-}
-
-/*
- * Initialises all platforms.
- * Picks a random width, safe to true
- * Position is initially set to the bottom of the screen, in the center.
+ * Row holding a platform at y, rounding down. With double physics it only takes
+ * whole numbers, for any y above -PLATFORM_ROW_BIAS, so that platform_step_all
+ * compares rows rather than positions: the compiler cannot vectorise a loop
+ * comparing doubles into int flags. Fixed-point rows are a shift already.
  */
-void initialize_platforms( platform* plat, int no_plats ){
-	for ( int i = 0; i < no_plats; i++ ) {	
-		plat[i].safe = true;
-		plat[i].is_visible = true;
-		plat[i].width = rand_between( 5, 10 ); // sets random width between 5-10 characters
-		
-		int x = (( screen_width() - 1) / 2 ) - ( plat[i].width / 2); // Sets x position to middle of screen
-		int y = screen_height() - 4;
-		
-		plat[i].x = x;
-		plat[i].y = y;
-		plat[i].dy = BASE_DY;
-	}
-}
-
+#ifdef FIXED_PHYSICS
+#define platform_row(y) num_floor( y )
+#else
+#define PLATFORM_ROW_BIAS 1024
+#define platform_row(y) ( num_trunc( ( y ) + NUM_INT( PLATFORM_ROW_BIAS ) ) - PLATFORM_ROW_BIAS )
+#endif
 
 /*
- * Sets position of platform 2.
- * creates random y position that is between 5 and 10 spaces below plat1 
- * x position is random, but cannot exceed the screen width - platform width
+ * Random number generator for the platforms and the boss (splitmix64). Every
+ * session has its own, so sessions run side by side on several threads draw
+ * the same numbers as they would alone.
  */
-void spawn_under( platform plat1, platform* plat2 ){
-	int y0 = round ( plat1. y );
-	
-	int x = rand_between( 0, screen_width() - plat2->width ); // offsets x position depending on first platform
-	
-	plat2->x = x;
-	plat2->y = rand_between(y0 + 5, y0 + 10); // creates a random y position between plat1.y and 5
-}
-
-void spawn_next( platform plat1, platform* plat2 ){
-	int threshold = screen_width() - ( plat1.width + plat2->width); // number of spaces the platform can occupy
-	
-	int offset = rand_between( 4, threshold );
-	
-	plat2->x = (int)( plat1.x + plat1.width + offset ) % ( screen_width() - 1 ); // x position will wrap around;
-	plat2->y = plat1.y + rand_between(0, 6);
-}
+typedef struct game_rng{
+	unsigned long long state;
+} game_rng;
 
 /*
- * Tries to move the platform; returns true if the platform moved, and false otherwise
+ * Type definition for the platforms, stored as one array per field so that
+ * process_platform can move them all in a single pass which the compiler
+ * can vectorise. Platform i is made up of element i of each array.
  */
-bool process_platform( platform*plat, int no_plats, int level, double speed ) {
-	bool platform_moved = false;
-
-	for ( int i = 0; i < no_plats; i++ ) {
-		if ( plat[i].is_visible ){
-			double x0 = round( plat[i].x ); // remembers original position
-			double y0 = round( plat[i].y );
+typedef struct platform_store{
+	int count; // number of platforms
 
-			//sprite_fall_up(platform[i]); // platform falls upwards
-			platform_fall( &(plat[i]), level, speed);
+	num* x; // x position (top left corner)
+	num* y; // y position (top left corner)
+	num* dy; // change in y position
+	int* width; // platform width
+	int* spawn_id; // number of platforms spawned before this one since setup
 
-			if ( plat[i].y < - 3 ) { // if platform reaches the top of the screen
-				plat[i].is_visible = false; // platform becomes invisible
-			}
-			
-			platform_moved = platform_moved || round( plat[i].x ) != x0 
-											|| round( plat[i].y ) != y0;
-			// platform will have moved if the new rounded positions are not the same as the original positions.
-		}
-	}
+	bool* safe; // is platform safe
+	int* is_visible; // nonzero if platform is visible; int rather than bool, so platform_step_all can vectorise
 
-	return platform_moved;
-}
+	screen_rect* drawn; // screen area covered when last drawn
 
+	unsigned long long* changed; // bit i % 64 of word i / 64 is set if platform i changed row in the last step
+} platform_store;
 
 /*
- *	Draws the platforms.
+ * Spatial index over the platforms, so that collision tests only look at
+ * platforms near the player.
+ *
+ * The play area is divided into cells GRID_CELL_W columns wide and
+ * GRID_CELL_H rows high, and each visible platform is filed under the cell
+ * holding its top left corner. Cells are hashed into a power-of-two table of
+ * buckets, so a layout may extend any distance. Each bucket is a doubly
+ * linked list threaded through next and prev by platform index, so a
+ * platform moving to another cell is refiled in constant time.
  */
-void draw_platforms( platform*plat, int no_plats ) {
-	for ( int i = 0; i < no_plats; i++ ) {
-		if ( plat[i].is_visible ){
-			draw_single_platform( plat[i] );
-		}
-	}
-}
+#define GRID_CELL_W 16
+#define GRID_CELL_H 4
+
+typedef struct platform_grid{
+	platform_store* store; // platforms indexed
+	int max_width; // widest platform indexed
+
+	int bucket_count; // power of two
+	int* buckets; // first platform in each bucket, or -1
+	int* next; // neighbours in the bucket, per platform, or -1
+	int* prev;
+	int* cell_x; // cell each platform is filed under
+	int* cell_y;
+	bool* filed; // false for platforms not in the index
+} platform_grid;
 
 /*
- * Draws a single platform
+ * Ring of platform slots for endless play.
+ *
+ * Platforms are spawned in a chain, each placed relative to the one before
+ * (see setup_platform), so they scroll off the top of the screen in the
+ * order they were spawned. The slot of the platform highest up the chain
+ * is the next to expire; once it has, it is reused for a new platform at
+ * the bottom of the chain, below the screen. The platforms never leave
+ * their fixed arrays, so an endless session uses constant memory.
  */
-void draw_single_platform(platform plat){
-	char character;
-	
-	if ( plat.safe ){
-		character = '=';
-	} else {
-		character = 'x';
-	}
-	
-	draw_line( plat.x, plat.y, plat.x + plat.width, plat.y, character );
-	draw_line( plat.x, plat.y + 1, plat.x + plat.width, plat.y + 1, character );
-}
+typedef struct platform_ring{
+	int oldest; // slot of the platform highest up the chain
+	int spawned; // number of platforms spawned since setup
+} platform_ring;
 
-/*
- * Makes the platform fall. Behavior depends on the level.
- */
- 
- void platform_fall( platform* plat, int level, double speed ){
-	 if ( level == 1 || level == 2 ){
-		 platform_fall_NG( plat );
-	 } else {
-		 platform_fall_G( plat, speed );
-	 }
- }
-
- 
-/*
- * Makes platform fall with a constant speed.
- */
-void platform_fall_NG( platform* plat ){
-	plat->y += BASE_DY;
-}
 
-/*
- * Makes platform fall, taking a speed multiplier into consideration
- */
-void platform_fall_G( platform* plat, int speed ){
-	plat->y += plat->dy * speed * SPEED_MULTIPLIER;
-}
\ No newline at end of file
+// ----------------------------------------------------------------
+// Forward declaration of functions
+// ----------------------------------------------------------------
+void rng_seed( game_rng* rng, unsigned long long seed );
+unsigned long long rng_next( game_rng* rng );
+int rand_between( game_rng* rng, int first, int last );
+bool platform_store_init( platform_store* store, int count );
+void platform_store_release( platform_store* store );
+void setup_platform( platform_store* store, int level, game_rng* rng );
+void initialize_platforms( platform_store* store, game_rng* rng );
+void spawn_under( platform_store* store, int from, int i, game_rng* rng );
+void spawn_next( platform_store* store, int from, int i, game_rng* rng );
+bool process_platform( platform_store* store, int level, int speed, platform_grid* grid );
+bool platform_step_all( platform_store* store, num base, int speed );
+void setup_ring( platform_ring* ring, int no_plats );
+bool recycle_platforms( platform_ring* ring, platform_store* store, platform_grid* grid, game_rng* rng );
+void respawn_platform( platform_store* store, int i, int newest, int spawn_id, game_rng* rng );
+void draw_platforms( platform_store* store );
+void draw_single_platform( platform_store* store, int i );
+bool grid_init( platform_grid* grid, int no_plats );
+void grid_release( platform_grid* grid );
+void grid_build( platform_grid* grid, platform_store* store );
+void grid_update( platform_grid* grid, int i );
+int grid_find( platform_grid* grid, num x, num y, bool ( *touches )( platform_store* store, int i, num x, num y ) );
+int grid_cell( num position, int size );
+int grid_bucket( platform_grid* grid, int cx, int cy );
+void grid_unlink( platform_grid* grid, int i );
+
+#endif
\ No newline at end of file
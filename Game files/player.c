@@ -0,0 +1,231 @@
+#include <stdlib.h>
+#include <math.h>
+#include "cab202_graphics.h"
+#include "cab202_sprites.h"
+#include "player.h"
+
+// ----------------------------------------------------------------
+// Player functions
+// ----------------------------------------------------------------
+
+/*
+ *	Draws the player, and reports the area it covers.
+ */
+void draw_player( player_id* player ) {
+	sprite_id sprite = player->player_sprite;
+	
+	body_to_sprite( &player->body, sprite );
+	
+	if ( sprite->is_visible ){
+		mark_dirty_move( &player->drawn, round( sprite->x ), round( sprite->y ), sprite->width, sprite->height );
+	} else {
+		mark_dirty_move( &player->drawn, 0, 0, 0, 0 );
+	}
+	
+	sprite_draw( sprite );
+}
+
+/*
+ * Processes the player. Returns a boolean value indicating whether the player has moved or not.
+ */
+bool process_player( player_id* player, int key, int level, platform_grid* grid, boss_id boss ) {
+	platform_store* platforms = grid->store;
+	
+	if ( player->player_sprite->is_visible ){
+		bool player_moved = false;
+		
+		int x0 = num_round( player->body.x ); // remembers original position
+		int y0 = num_round( player->body.y );
+		
+		process_key_player( player, key, level , grid ); // moves the player based on key input
+		
+		player_fall( player, level );
+
+		if ( player->body.y >= NUM_INT( screen_height() - 5 ) ){ // if player reaches the bottom of the screen
+			player->player_sprite->is_visible = false;
+			player->death = DEATH_FELL;
+		} else if ( player->body.y < NUM_INT( 2 ) ) { // if player hits the top of the screen
+			player->player_sprite->is_visible = false;
+			player->death = DEATH_TOP;
+		}
+		
+		int platform_hit = hit_top_platform( grid, player ); // detects which platform the player has hit (if any)
+		
+		if ( platform_hit >= 0 ){ // if player has hit a platform
+			if ( platforms->safe[platform_hit] ){
+				player->body.y = platforms->y[platform_hit] - NUM_INT( 3 ); // match platform's behavior
+				player->body.dy = 0;
+				player->on_platform = true;
+				
+				if ( player->last_platform_hit != platforms->spawn_id[platform_hit] ){
+					player->score++; // increment score if player is not on last platform hit
+					player->last_platform_hit = platforms->spawn_id[platform_hit];
+				}
+			} else{
+				player->player_sprite->is_visible = false; // player dies
+				player->death = DEATH_UNSAFE;
+			}
+		} else{
+			player->on_platform = false; // otherwise player is not on platform
+		}
+		
+		bool boss_hit = hit_boss( &boss, player );
+		
+		if ( boss_hit ){ // if player has hit boss
+			player->player_sprite->is_visible = false; // player dies
+			player->death = DEATH_BOSS;
+		}
+					
+		player_moved = player_moved || num_round( player->body.x ) != x0 
+									|| num_round( player->body.y ) != y0;
+		// platform will have moved if the new rounded positions are not the same as the original positions.
+		return player_moved;
+	} else {
+		return false;
+	}
+ }
+
+ 
+/*
+ * Processes key presses from player
+ */ 
+void process_key_player( player_id* player, int key, int level, platform_grid* grid ){
+	if( level == 1 ){
+		process_key_LVL1( player, key, grid );
+	} else {
+		process_key_LVL2( player, key, grid );
+	}
+}
+
+/*
+ * Processes keys for level 1
+ */
+void process_key_LVL1( player_id* player, int key, platform_grid* grid ){
+	if ( key == KEY_LEFT && player->on_platform && !hit_side_platform( grid, player )){
+		player->body.x -= NUM_INT( 1 );
+	} else if ( key == KEY_RIGHT && player->on_platform && !hit_side_platform( grid, player )){
+		player->body.x += NUM_INT( 1 );
+	}
+	
+	// makes sure sprite is still in window
+	while ( player->body.y < 0 ) player->body.y += NUM_INT( 1 );
+	while( player->body.x < 0 ) player->body.x += NUM_INT( 1 );
+	while( player->body.x > NUM_INT( screen_width() - 1 ) ) player->body.x -= NUM_INT( 1 );
+}
+
+/*
+ * Processes keys for level 2
+ */
+void process_key_LVL2( player_id* player, int key, platform_grid* grid ){
+	if( key == KEY_UP && player->on_platform ){ // if player has not already jumped
+		player->body.y -= NUM( 0.5 ); // moves the player slightly off the platform
+		player->body.dy = -NUM( BASE_JUMP_DY ); // gives the player a vertical velocity
+	} else if ( key == KEY_DOWN && player->on_platform ){ // if player is already on platform
+		player->body.dx = 0;
+	} else if ( key == KEY_LEFT && player->on_platform ){
+		player->body.dx = -NUM( BASE_DX_PLAYER ); // gives the player horizontal velocity
+	} else if ( key == KEY_RIGHT && player->on_platform ){
+		player->body.dx = NUM( BASE_DX_PLAYER ); 
+	}
+	
+	if( hit_side_platform( grid, player )){
+		player->body.dx = 0; // stops sprite from moving if player hits side of platform
+	}
+	
+	body_step( &player->body ); // updates player position
+	
+	// makes sure sprite is still in window
+	while ( player->body.y < 0 ){
+		player->body.y += NUM_INT( 1 );
+	} 
+	while( player->body.x < 0 ){
+		player->body.x += NUM_INT( 1 );
+		player->body.dx = 0;
+	} 
+	while( player->body.x > NUM_INT( screen_width() - 1 ) ){
+		player->body.x -= NUM_INT( 1 );
+		player->body.dx = 0;
+	} 
+}
+
+/*
+ * Makes player fall
+ */
+void player_fall( player_id* player, int level ){
+	if ( level == 1 ){
+		player_fallNG( player );
+	} else {
+		player_fallG( player );
+	}
+}
+ 
+/*
+ * Makes player fall with no gravity
+ */
+ void player_fallNG( player_id* player ){
+	 player->body.dy = NUM( BASE_DY_PLAYER );
+	 body_step( &player->body );
+ }
+
+/*
+ * Makes player fall under the influence of gravity
+ * (don't drink and fall kids)
+ */
+ void player_fallG( player_id* player ){
+	player->body.y += num_mul( player->body.dy, NUM( TIMESTEP_PLAYER ) );
+	player->body.dy += NUM( ACCEL_PLAYER * TIMESTEP_PLAYER );
+ }
+ 
+/*
+ * Method for determining if the player hit a platform.
+ * Returns the platform index of hit platform.
+ * returns -1 otherwise.
+ */ 
+int hit_top_platform( platform_grid* grid, player_id* player ){
+	return grid_find( grid, player->body.x, player->body.y, touches_top );
+ }
+ 
+/*
+ * Returns true if player has hit the side of a platform
+ */
+bool hit_side_platform( platform_grid* grid, player_id* player ){
+	return grid_find( grid, player->body.x, player->body.y, touches_side ) >= 0;
+}
+
+/*
+ * Returns true if a player at (x,y) is standing on the platform
+ */
+bool touches_top( platform_store* store, int i, num x, num y ){
+	return y > ( store->y[i] - NUM_INT( 3 ) ) && y < ( store->y[i] + NUM_INT( 1 ) ) 
+		&& x <= ( store->x[i] + NUM_INT( store->width[i] ) ) && x >= store->x[i];
+}
+
+/*
+ * Returns true if a player at (x,y) is against the side of the platform
+ */
+bool touches_side( platform_store* store, int i, num x, num y ){
+	return y > ( store->y[i] - NUM_INT( 2 ) ) && y < ( store->y[i] + NUM_INT( 1 ) ) 
+		&& x <= ( store->x[i] + NUM_INT( store->width[i] ) + NUM_INT( 1 ) ) && x >= store->x[i] - NUM_INT( 1 );
+}
+
+/*
+ * Returns true if player has hit the boss
+ */
+bool hit_boss( boss_id* boss, player_id* player ){	
+	num distance = dist_from_boss( boss->body.x, boss->body.y, boss->radius,
+									player->body.x, player->body.y );
+	bool hit = distance <= NUM_INT( boss->radius );
+	
+	return hit;
+}
+
+/*
+ * Calculates distance between two sets of co-ordinates
+ */
+num dist_from_boss( num xb, num yb, int rb, num x, num y ){
+	num dx = xb + NUM_INT( rb ) - x;
+	num dy = yb + NUM_INT( rb ) - y;
+	
+	num dist = num_hypot( dx, dy );
+	return dist;
+}
\ No newline at end of file
@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cab202_graphics.h"
+#include "cab202_timers.h"
+#include "replay.h"
+#include <ncurses.h>
+
+// ----------------------------------------------------------------
+// Replay functions
+// ----------------------------------------------------------------
+
+/*
+ * Starts recording a session. Returns false if the file cannot be created.
+ */
+bool replay_start_recording( replay_id* replay, const char* file_name, unsigned long long seed, int width, int height ){
+	replay->file = fopen( file_name, "wb" );
+	
+	if ( replay->file == NULL ){
+		return false;
+	}
+	
+	replay->mode = REPLAY_RECORD;
+	replay->seed = seed;
+	replay->width = width;
+	replay->height = height;
+	replay->tick = 0;
+	replay->event_tick = 0;
+	
+	unsigned char header[REPLAY_HEADER_SIZE];
+	memcpy( header, REPLAY_MAGIC, 8 );
+	
+	for ( int i = 0; i < 4; i++ ){
+		header[8 + i] = ( REPLAY_VERSION >> ( 8 * i ) ) & 0xff;
+	}
+	for ( int i = 0; i < 8; i++ ){
+		header[12 + i] = ( seed >> ( 8 * i ) ) & 0xff;
+	}
+	
+	header[20] = width & 0xff;
+	header[21] = ( width >> 8 ) & 0xff;
+	header[22] = height & 0xff;
+	header[23] = ( height >> 8 ) & 0xff;
+	
+	fwrite( header, 1, REPLAY_HEADER_SIZE, replay->file );
+	return true;
+}
+
+/*
+ * Loads a recorded session for playback. Returns false if the file cannot be read,
+ * sized (a pipe, say) or held in memory.
+ */
+bool replay_start_playback( replay_id* replay, const char* file_name ){
+	FILE* file = fopen( file_name, "rb" );
+	
+	if ( file == NULL ){
+		return false;
+	}
+	
+	replay->size = ( fseek( file, 0, SEEK_END ) == 0 ) ? ftell( file ) : -1; // -1 if not seekable
+	fseek( file, 0, SEEK_SET );
+	
+	replay->data = ( replay->size >= REPLAY_HEADER_SIZE ) ? malloc( replay->size ) : NULL;
+	bool ok = replay->data != NULL
+			&& fread( replay->data, 1, replay->size, file ) == (size_t) replay->size
+			&& memcmp( replay->data, REPLAY_MAGIC, 8 ) == 0
+			&& replay->data[8] == REPLAY_VERSION;
+	fclose( file );
+	
+	if ( !ok ){
+		free( replay->data );
+		replay->data = NULL;
+		return false;
+	}
+	
+	unsigned char* header = replay->data;
+	replay->seed = 0;
+	
+	for ( int i = 7; i >= 0; i-- ){
+		replay->seed = ( replay->seed << 8 ) | header[12 + i];
+	}
+	
+	replay->width = header[20] | ( header[21] << 8 );
+	replay->height = header[22] | ( header[23] << 8 );
+	replay->mode = REPLAY_PLAYBACK;
+	replay->position = REPLAY_HEADER_SIZE;
+	replay->tick = 0;
+	replay->event_tick = 0;
+	
+	replay_read_event( replay );
+	return true;
+}
+
+/*
+ * Advances to the next loop tick. Called once at the top of each pass through the event loop.
+ */
+void replay_next_tick( replay_id* replay ){
+	replay->tick++;
+}
+
+/*
+ * Gets the next key without waiting, from the keyboard or from the replay log.
+ */
+int replay_get_char( replay_id* replay ){
+	if ( replay->mode == REPLAY_PLAYBACK ){
+		if ( !replay->has_next ){
+			return 'q'; // log exhausted: end the session
+		}
+		if ( replay->next_type != REPLAY_EVENT_KEY || replay->next_tick != replay->tick ){
+			return ERR;
+		}
+		
+		int key = replay->next_key;
+		replay_read_event( replay );
+		return key;
+	}
+	
+	int key = get_char();
+	
+	if ( key != ERR ){
+		replay_write_event( replay, REPLAY_EVENT_KEY, key );
+	}
+	
+	return key;
+}
+
+/*
+ * Waits for a key, from the keyboard or from the replay log.
+ */
+int replay_wait_char( replay_id* replay ){
+	if ( replay->mode == REPLAY_PLAYBACK ){
+		if ( !replay->has_next || replay->next_type != REPLAY_EVENT_WAIT ){
+			return 'q'; // log exhausted, or out of step with the session
+		}
+		
+		int key = replay->next_key;
+		replay_read_event( replay );
+		return key;
+	}
+	
+	int key = wait_char();
+	replay_write_event( replay, REPLAY_EVENT_WAIT, key );
+	return key;
+}
+
+/*
+ * Asks the scheduler, or the replay log, how many steps the game should advance by.
+ * Each step is logged as a separate tick event, so steps run to catch up are replayed too.
+ * The scheduler is consulted during playback as well, to keep its deadlines moving.
+ */
+int replay_ticks_due( replay_id* replay, tick_scheduler* scheduler ){
+	int ticks = scheduler_ticks_due( scheduler );
+	
+	if ( replay->mode == REPLAY_PLAYBACK ){
+		ticks = 0;
+		
+		while ( replay->has_next && replay->next_type == REPLAY_EVENT_TICK && replay->next_tick == replay->tick ){
+			replay_read_event( replay );
+			ticks++;
+		}
+		return ticks;
+	}
+	
+	for ( int i = 0; i < ticks; i++ ){
+		replay_write_event( replay, REPLAY_EVENT_TICK, 0 );
+	}
+	
+	return ticks;
+}
+
+/*
+ * Ends a recording or playback.
+ * When recording, stores the final state hash. When playing back, compares the
+ * final state hash with the recorded one, returning true if they match.
+ */
+bool replay_finish( replay_id* replay, unsigned long long hash ){
+	bool match = true;
+	
+	if ( replay->mode == REPLAY_RECORD ){
+		replay_write_event( replay, REPLAY_EVENT_END, 0 );
+		
+		for ( int i = 0; i < 8; i++ ){
+			fputc( ( hash >> ( 8 * i ) ) & 0xff, replay->file );
+		}
+		
+		fclose( replay->file );
+		replay->file = NULL;
+	} else if ( replay->mode == REPLAY_PLAYBACK ){
+		while ( replay->has_next ){ // skip to the end of the log
+			replay_read_event( replay );
+		}
+		
+		match = replay->next_type == REPLAY_EVENT_END && replay->end_hash == hash;
+		free( replay->data );
+		replay->data = NULL;
+	}
+	
+	return match;
+}
+
+/*
+ * Adds a block of memory to a 64-bit FNV-1a hash.
+ */
+unsigned long long replay_hash( unsigned long long hash, const void* data, int size ){
+	const unsigned char* bytes = data;
+	
+	for ( int i = 0; i < size; i++ ){
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	
+	return hash;
+}
+
+/*
+ * Appends an event to the log being recorded.
+ */
+void replay_write_event( replay_id* replay, int type, int key ){
+	if ( replay->mode != REPLAY_RECORD ){
+		return;
+	}
+	
+	unsigned long long delta = replay->tick - replay->event_tick;
+	replay->event_tick = replay->tick;
+	
+	replay_put_varint( replay->file, delta * 4 + type );
+	
+	if ( type == REPLAY_EVENT_KEY || type == REPLAY_EVENT_WAIT ){
+		replay_put_varint( replay->file, (unsigned) key );
+	}
+}
+
+/*
+ * Reads the next event of the log being played back into has_next, next_type, next_tick and next_key.
+ */
+void replay_read_event( replay_id* replay ){
+	unsigned long long value, key = 0;
+	replay->has_next = false;
+	
+	if ( !replay_get_varint( replay, &value ) ){
+		return;
+	}
+	
+	replay->next_type = value % 4;
+	replay->next_tick = replay->event_tick + value / 4;
+	replay->event_tick = replay->next_tick;
+	
+	if ( replay->next_type == REPLAY_EVENT_END ){
+		replay->end_hash = 0;
+		
+		for ( int i = 7; i >= 0 && replay->position + i < replay->size; i-- ){
+			replay->end_hash = ( replay->end_hash << 8 ) | replay->data[replay->position + i];
+		}
+		
+		replay->position = replay->size;
+		return;
+	}
+	
+	if ( replay->next_type != REPLAY_EVENT_TICK && !replay_get_varint( replay, &key ) ){
+		return;
+	}
+	
+	replay->next_key = (int) key;
+	replay->has_next = true;
+}
+
+/*
+ * Writes an unsigned LEB128 varint.
+ */
+void replay_put_varint( FILE* file, unsigned long long value ){
+	while ( value >= 0x80 ){
+		fputc( ( value & 0x7f ) | 0x80, file );
+		value >>= 7;
+	}
+	
+	fputc( value, file );
+}
+
+/*
+ * Reads an unsigned LEB128 varint from the log being played back. Returns false at the end of the log.
+ */
+bool replay_get_varint( replay_id* replay, unsigned long long* value ){
+	*value = 0;
+	
+	for ( int shift = 0; replay->position < replay->size && shift < 64; shift += 7 ){
+		unsigned char byte = replay->data[replay->position++];
+		*value |= (unsigned long long)( byte & 0x7f ) << shift;
+		
+		if ( byte < 0x80 ){
+			return true;
+		}
+	}
+	
+	return false;
+}
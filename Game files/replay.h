@@ -0,0 +1,76 @@
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "cab202_timers.h"
+
+#define REPLAY_MAGIC "ZJREPLAY"
+#define REPLAY_VERSION 3 // version 1 drew platforms and the boss from rand(), and version 2 ramped the speed once per loop pass; neither replays
+#define REPLAY_HEADER_SIZE 24
+
+// Replay modes
+#define REPLAY_OFF 0
+#define REPLAY_RECORD 1
+#define REPLAY_PLAYBACK 2
+
+// Events in a replay log
+#define REPLAY_EVENT_TICK 0 // a simulation step was due (one event per step)
+#define REPLAY_EVENT_KEY 1 // get_char returned a key
+#define REPLAY_EVENT_WAIT 2 // wait_char returned a key
+#define REPLAY_EVENT_END 3 // end of session, followed by the final state hash
+
+/*
+ * Type definition for a session recording or playback.
+ *
+ * A replay file holds everything that makes one session differ from another:
+ * the random seed, the screen size, and every input consumed by the event loop,
+ * stamped with the loop tick at which it was consumed.
+ *
+ * File format (integers little-endian):
+ *	"ZJREPLAY", u32 version, u64 seed, u16 width, u16 height.
+ *	Events: varint ( ticks since previous event * 4 + event type ), then a
+ *	varint key for KEY and WAIT events, or 8 bytes of state hash for END.
+ */
+typedef struct replay_id{
+	int mode; // REPLAY_OFF, REPLAY_RECORD or REPLAY_PLAYBACK
+	bool fast; // playback without pauses or drawing
+	
+	unsigned long long seed; // random seed for the session
+	int width; // screen size for the session
+	int height;
+	
+	long tick; // current loop tick
+	long event_tick; // tick of the previous event
+	
+	FILE* file; // log being recorded
+	
+	unsigned char* data; // log being played back
+	long size;
+	long position;
+	
+	bool has_next; // next event to be played back
+	int next_type;
+	long next_tick;
+	int next_key;
+	
+	unsigned long long end_hash; // final state hash stored in the log
+} replay_id;
+
+// ----------------------------------------------------------------
+// Forward declaration of functions
+// ----------------------------------------------------------------
+bool replay_start_recording( replay_id* replay, const char* file_name, unsigned long long seed, int width, int height );
+bool replay_start_playback( replay_id* replay, const char* file_name );
+void replay_next_tick( replay_id* replay );
+int replay_get_char( replay_id* replay );
+int replay_wait_char( replay_id* replay );
+int replay_ticks_due( replay_id* replay, tick_scheduler* scheduler );
+bool replay_finish( replay_id* replay, unsigned long long hash );
+unsigned long long replay_hash( unsigned long long hash, const void* data, int size );
+void replay_write_event( replay_id* replay, int type, int key );
+void replay_read_event( replay_id* replay );
+void replay_put_varint( FILE* file, unsigned long long value );
+bool replay_get_varint( replay_id* replay, unsigned long long* value );
+
+#endif
\ No newline at end of file
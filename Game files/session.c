@@ -0,0 +1,287 @@
+#include <stdlib.h>
+#include <string.h>
+#include "cab202_graphics.h"
+#include "cab202_sprites.h"
+#include "cab202_bitmap_atlas.h"
+#include "cab202_timer_wheel.h"
+#include "session.h"
+#include "replay.h"
+
+// ----------------------------------------------------------------
+// Session functions
+// ----------------------------------------------------------------
+
+/*
+ * Allocates a session, with random seed seed, at level 1 and normal speed.
+ * Returns false if memory could not be allocated.
+ */
+bool session_init( game_session* session, unsigned long long seed ){
+	memset( session, 0, sizeof( game_session ) );
+	rng_seed( &session->rng, seed );
+	session->level = 1;
+	session->lives = START_LIVES;
+	session->speed = NORMAL;
+	session->desired_speed = NORMAL;
+	
+	if ( !timer_wheel_init( &session->events, MAX_EVENTS )
+		|| !platform_store_init( &session->platforms, NO_PLATFORMS )
+		|| !grid_init( &session->grid, NO_PLATFORMS ) ){
+		session_release( session );
+		return false;
+	}
+	
+	return true;
+}
+
+/*
+ * Frees the timers, platforms, sprites and bitmaps of a session.
+ */
+void session_release( game_session* session ){
+	timer_wheel_release( &session->events );
+	grid_release( &session->grid );
+	platform_store_release( &session->platforms );
+	sprite_destroy( session->player.player_sprite );
+	
+	if ( session->boss.sprite_boss != NULL && !session->borrowed ){
+		clear_bitmaps( &session->boss );
+	}
+	sprite_destroy( session->boss.sprite_boss );
+	
+	memset( session, 0, sizeof( game_session ) );
+}
+
+/*
+ * Places the player, platforms and boss for a new round, at the current level.
+ * Needs no terminal, only a screen size.
+ */
+void session_setup_round( game_session* session ){
+	timer_wheel_clear( &session->events ); // cancels events left from the previous round
+	setup_player( &session->player );
+	setup_platform( &session->platforms, session->level, &session->rng );
+	grid_build( &session->grid, &session->platforms );
+	setup_ring( &session->ring, NO_PLATFORMS );
+	setup_boss( &session->boss, &session->rng, &session->events );
+}
+
+/*
+ * Makes session to the same as session from, so that it can be run ahead without
+ * changing from. to must have been allocated by session_init, and is not set up for
+ * a round afterwards: its boss's bitmaps belong to from, which must keep them while
+ * to is used. Nothing is allocated after the first copy into a session, which
+ * creates its sprites; they only carry what the simulation reads of them.
+ */
+void session_copy( game_session* to, const game_session* from ){
+	sprite_id player_sprite = to->player.player_sprite;
+	sprite_id boss_sprite = to->boss.sprite_boss;
+	platform_store* store = &to->platforms;
+	platform_grid* grid = &to->grid;
+	int count = from->platforms.count;
+	
+	if ( player_sprite == NULL ){
+		player_sprite = sprite_create( 0, 0, 1, 1, " " );
+	}
+	if ( boss_sprite == NULL ){
+		boss_sprite = sprite_create( 0, 0, 1, 1, " " );
+	}
+	
+	to->rng = from->rng;
+	to->level = from->level;
+	to->lives = from->lives;
+	to->speed = from->speed;
+	to->desired_speed = from->desired_speed;
+	to->ramp_steps = from->ramp_steps;
+	to->ring = from->ring;
+	to->borrowed = true;
+	
+	to->player = from->player;
+	to->player.player_sprite = player_sprite;
+	player_sprite->is_visible = from->player.player_sprite->is_visible;
+	
+	to->boss = from->boss;
+	to->boss.sprite_boss = boss_sprite;
+	boss_sprite->is_visible = from->boss.sprite_boss->is_visible;
+	sprite_set_bitmap( boss_sprite, from->boss.sprite_boss->image ); // nothing to do unless the boss has turned
+	
+	memcpy( store->x, from->platforms.x, count * sizeof( num ) );
+	memcpy( store->y, from->platforms.y, count * sizeof( num ) );
+	memcpy( store->dy, from->platforms.dy, count * sizeof( num ) );
+	memcpy( store->width, from->platforms.width, count * sizeof( int ) );
+	memcpy( store->spawn_id, from->platforms.spawn_id, count * sizeof( int ) );
+	memcpy( store->safe, from->platforms.safe, count * sizeof( bool ) );
+	memcpy( store->is_visible, from->platforms.is_visible, count * sizeof( int ) );
+	
+	grid->store = store;
+	grid->max_width = from->grid.max_width;
+	memcpy( grid->buckets, from->grid.buckets, grid->bucket_count * sizeof( int ) );
+	memcpy( grid->next, from->grid.next, count * sizeof( int ) );
+	memcpy( grid->prev, from->grid.prev, count * sizeof( int ) );
+	memcpy( grid->cell_x, from->grid.cell_x, count * sizeof( int ) );
+	memcpy( grid->cell_y, from->grid.cell_y, count * sizeof( int ) );
+	memcpy( grid->filed, from->grid.filed, count * sizeof( bool ) );
+	
+	// The boss's events point at from's boss; the copies point at to's.
+	timer_wheel_copy( &to->events, &from->events, from, to, sizeof( game_session ) );
+}
+
+/*
+ * Runs one simulation step, with key acting on the player (ERR for none).
+ * Returns true if anything moved on screen.
+ */
+bool session_step( game_session* session, int key ){
+	return session_step_timed( session, key, NULL, NULL );
+}
+
+/*
+ * Runs one simulation step as session_step does, calling lap with context as
+ * each part of it ends (STEP_PLAYER, STEP_PLATFORMS, STEP_BOSS), unless lap is NULL.
+ */
+bool session_step_timed( game_session* session, int key, step_lap lap, void* context ){
+	timer_wheel_advance( &session->events, 1 ); // fires the events due on this step
+	bool player_changed = process_player( &session->player, key, session->level, &session->grid, session->boss );
+	
+	if ( lap != NULL ){
+		lap( context, STEP_PLAYER );
+	}
+	
+	bool platform_changed = process_platform( &session->platforms, session->level, session->speed, &session->grid );
+	recycle_platforms( &session->ring, &session->platforms, &session->grid, &session->rng ); // new platforms start below the screen
+	
+	if ( lap != NULL ){
+		lap( context, STEP_PLATFORMS );
+	}
+	
+	bool boss_changed = process_boss( &session->boss, session->level );
+	session_ramp_speed( session );
+	
+	if ( lap != NULL ){
+		lap( context, STEP_BOSS );
+	}
+	
+	return player_changed || platform_changed || boss_changed;
+}
+
+/*
+ * Moves the speed towards the desired speed, by SPEED_RAMP every two steps
+ * (alternately 2 and 3), without passing it.
+ */
+void session_ramp_speed( game_session* session ){
+	int gap = session->desired_speed - session->speed;
+	
+	if ( gap == 0 ){
+		session->ramp_steps = 0;
+		return;
+	}
+	
+	int change = ( session->ramp_steps % 2 == 0 ) ? SPEED_RAMP / 2 : SPEED_RAMP - SPEED_RAMP / 2;
+	session->ramp_steps++;
+	
+	if ( change > abs( gap ) ){
+		change = abs( gap );
+	}
+	
+	session->speed += ( gap > 0 ) ? change : -change;
+}
+
+/*
+ * Computes a hash of the simulation state, used to check that a replay matches its recording.
+ */
+unsigned long long session_hash( game_session* session ){
+	unsigned long long hash = 14695981039346656037ULL; // FNV-1a offset basis
+	player_id* player = &session->player;
+	boss_id* boss = &session->boss;
+	platform_store* platforms = &session->platforms;
+	body* bodies[2] = { &player->body, &boss->body };
+	sprite_id sprites[2] = { player->player_sprite, boss->sprite_boss };
+	
+	for ( int i = 0; i < 2; i++ ){
+		hash = replay_hash( hash, &bodies[i]->x, sizeof( num ) );
+		hash = replay_hash( hash, &bodies[i]->y, sizeof( num ) );
+		hash = replay_hash( hash, &bodies[i]->dx, sizeof( num ) );
+		hash = replay_hash( hash, &bodies[i]->dy, sizeof( num ) );
+		hash = replay_hash( hash, &sprites[i]->is_visible, sizeof( bool ) );
+	}
+	
+	for ( int i = 0; i < NO_PLATFORMS; i++ ){
+		hash = replay_hash( hash, &platforms->x[i], sizeof( num ) );
+		hash = replay_hash( hash, &platforms->y[i], sizeof( num ) );
+		hash = replay_hash( hash, &platforms->safe[i], sizeof( bool ) );
+		bool visible = platforms->is_visible[i];
+		hash = replay_hash( hash, &visible, sizeof( bool ) );
+		hash = replay_hash( hash, &platforms->width[i], sizeof( int ) );
+	}
+	
+	hash = replay_hash( hash, &player->score, sizeof( int ) );
+	hash = replay_hash( hash, &boss->radius, sizeof( int ) );
+	hash = replay_hash( hash, &boss->turn_total, sizeof( int ) );
+	hash = replay_hash( hash, &session->lives, sizeof( int ) );
+	hash = replay_hash( hash, &session->level, sizeof( int ) );
+	hash = replay_hash( hash, &session->speed, sizeof( int ) );
+	hash = replay_hash( hash, &session->desired_speed, sizeof( int ) );
+	
+	return hash;
+}
+
+/*
+ * Sets ups player
+ */
+void setup_player( player_id* player ){
+	static char * bitmap = 
+	"0"
+	"|"
+	"M";
+	
+	player->body.x = NUM_INT( ( screen_width() - 1 ) / 2 );
+	player->body.y = NUM_INT( screen_height() - 7 );
+	player->body.dx = 0;
+	player->body.dy = 0;
+	
+	if ( player->player_sprite == NULL ){
+		player->player_sprite = sprite_create( 0, 0, 1, 3, bitmap); // moved to the body when drawn
+	} else { // reuses the sprite from the previous round
+		sprite_show( player->player_sprite );
+	}
+	player->on_platform = true;
+	player->last_platform_hit = 0;
+	player->score = 0;
+	player->update_score = false;
+	player->death = DEATH_NONE;
+}
+
+/*
+ * Sets up boss sprite. Clears previous boss sprites and bitmaps, if they exist.
+ * Its appearance and turn are scheduled on events.
+ */
+void setup_boss( boss_id* boss, game_rng* rng, timer_wheel* events ){
+	
+	if ( boss->sprite_boss != NULL ){ // clears memory from bitmaps
+		clear_bitmaps( boss );
+	}
+	boss->radius = rand_between( rng, 5, 15 );
+	
+	create_directional_bitmaps( boss );
+	
+	if ( boss->sprite_boss == NULL ){
+		boss->sprite_boss = sprite_create( 0, 0, boss->radius * 2, 
+							boss->radius * 2, bitmap_data( boss->bitmap_right ) ); // moved to the body when drawn
+	} else { // reuses the sprite from the previous round
+		sprite_show( boss->sprite_boss );
+	}
+	sprite_set_bitmap( boss->sprite_boss, boss->bitmap_right ); // also sizes the sprite to the new radius
+	boss->body.x = NUM_INT( -2 * boss->radius );
+	boss->body.y = NUM_INT( screen_height() );
+	boss->body.dx = NUM( 0.1 );
+	boss->body.dy = ( -rand_between( rng, 1, 20 ) * NUM( 0.005 ) ); // boss moves in random diagonal direction
+	
+	boss->appear_delay = rand_between( rng, 130, 200 );
+	boss->appeared = false;
+	
+	boss->turn_delay = boss->appear_delay + rand_between( rng, 140, 300 );
+	boss->turning = false;
+	boss->turn_total = 0;
+	
+	// Every change of level resets, so on level 3 the delays count the boss's
+	// steps from the start of the level. Each event fires at the start of the
+	// step after its delay has passed.
+	timer_wheel_schedule( events, boss->appear_delay + 1, 0, BOSS_APPEAR, boss_event, boss );
+	timer_wheel_schedule( events, boss->appear_delay + boss->turn_delay + 1, 0, BOSS_TURN, boss_event, boss );
+}
\ No newline at end of file
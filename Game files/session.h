@@ -0,0 +1,73 @@
+#ifndef __SESSION_H__
+#define __SESSION_H__
+
+#include <stdbool.h>
+#include "cab202_timer_wheel.h"
+#include "player.h"
+
+#define NO_PLATFORMS 25
+#define MAX_EVENTS 64
+#define START_LIVES 3
+#define MAX_LEVEL 3
+
+// Speeds of level 3
+#define SLOW 25
+#define NORMAL 100
+#define FAST 400
+#define SPEED_RAMP 5 // change of speed per two steps on the way to the desired speed: one unit per 10 ms
+
+// Parts of a step, reported by session_step_timed
+#define STEP_PLAYER 0 // the events due, and process_player
+#define STEP_PLATFORMS 1 // process_platform and recycle_platforms
+#define STEP_BOSS 2 // process_boss and the speed ramp
+#define STEP_PARTS 3
+
+/*
+ * Called by session_step_timed as each part of a step ends, e.g. to read a clock.
+ */
+typedef void ( *step_lap )( void* context, int part );
+
+/*
+ * Type definition for a game session: everything the simulation of one game
+ * reads and changes, so that several sessions can be run at once, on
+ * different threads. Drawing, timing and the HUD belong to the program, not
+ * to a session.
+ *
+ * A session depends only on its seed and the keys it is given, and must not
+ * be moved once set up: the boss's events point into it.
+ */
+typedef struct game_session{
+	game_rng rng; // random numbers for the platforms and the boss
+	
+	int level; // current level
+	int lives; // remaining lives
+	int speed; // current speed
+	int desired_speed; // speed wanted on level 3; speed moves towards it a step at a time
+	int ramp_steps; // steps the speed has been moving towards desired_speed
+	
+	player_id player;
+	platform_store platforms;
+	platform_grid grid; // index of the platforms for collision tests
+	platform_ring ring; // reuses platforms which have scrolled away
+	boss_id boss;
+	
+	timer_wheel events; // timed game events, counted in steps; cleared by every new round
+	
+	bool borrowed; // set by session_copy: the boss's bitmaps belong to the session copied
+} game_session;
+
+// ----------------------------------------------------------------
+// Forward declaration of functions
+// ----------------------------------------------------------------
+bool session_init( game_session* session, unsigned long long seed );
+void session_release( game_session* session );
+void session_setup_round( game_session* session );
+void session_copy( game_session* to, const game_session* from );
+bool session_step( game_session* session, int key );
+bool session_step_timed( game_session* session, int key, step_lap lap, void* context );
+void session_ramp_speed( game_session* session );
+unsigned long long session_hash( game_session* session );
+void setup_player( player_id* player );
+void setup_boss( boss_id* boss, game_rng* rng, timer_wheel* events );
+
+#endif
\ No newline at end of file
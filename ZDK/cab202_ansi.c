@@ -0,0 +1,529 @@
+/*
+ *	cab202_ansi.c
+ *
+ *	Direct ANSI/VT display backend for the ZDK graphics library. The
+ *	terminal is driven with plain escape sequences instead of ncurses:
+ *	backend_put appends cursor movements and text to an output buffer, and
+ *	backend_refresh sends the whole frame with a single write(2).
+ *
+ *	If the terminal supports synchronized output (DEC private mode 2026),
+ *	each frame is bracketed by begin/end synchronized update sequences, so
+ *	the terminal never displays a half-drawn frame. Support is detected by
+ *	asking the terminal when the display is set up. The environment
+ *	variable ZDK_ANSI_SYNC overrides the detection: "1" always brackets
+ *	frames, "0" never does.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include "cab202_backend.h"
+
+/*
+ *	Value returned when no input is available, matching curses.
+ */
+#define ANSI_ERR (-1)
+
+/*
+ *	Key codes for the named keys, matching curses.
+ */
+#define ANSI_KEY_DOWN 0402
+#define ANSI_KEY_UP 0403
+#define ANSI_KEY_LEFT 0404
+#define ANSI_KEY_RIGHT 0405
+#define ANSI_KEY_HOME 0406
+#define ANSI_KEY_END 0550
+#define ANSI_KEY_DC 0512
+#define ANSI_KEY_IC 0513
+#define ANSI_KEY_NPAGE 0522
+#define ANSI_KEY_PPAGE 0523
+
+/*
+ *	Milliseconds to wait for the rest of an escape sequence after ESC, and
+ *	for the terminal to answer the synchronized output query.
+ */
+#define ANSI_ESCAPE_DELAY 25
+#define ANSI_QUERY_DELAY 100
+
+#define ANSI_DEFAULT_WIDTH 80
+#define ANSI_DEFAULT_HEIGHT 24
+
+#define ESC "\033"
+#define SYNC_BEGIN ESC "[?2026h"
+#define SYNC_END ESC "[?2026l"
+
+/*
+ *	Terminal state.
+ */
+static bool active = false;
+static struct termios saved_termios;
+static bool termios_saved = false;
+static bool sync_update = false;
+
+/*
+ *	Display size, refreshed when the terminal reports a resize.
+ */
+static int term_width = ANSI_DEFAULT_WIDTH;
+static int term_height = ANSI_DEFAULT_HEIGHT;
+static volatile sig_atomic_t resized = true;
+
+/*
+ *	Frame output buffer, and the cursor position after the bytes in it.
+ *	A cursor position of -1 means unknown.
+ */
+static char * out_buffer = NULL;
+static int out_length = 0;
+static int out_capacity = 0;
+static int cursor_x = -1;
+static int cursor_y = -1;
+
+/*
+ *	Bytes read from the terminal but not yet returned as keys.
+ */
+#define INPUT_BUFFER_SIZE 64
+static unsigned char in_buffer[INPUT_BUFFER_SIZE];
+static int in_length = 0;
+
+/*
+ *	Writes all of a block of bytes to the terminal.
+ */
+static void write_all( const char * data, int length ) {
+	while ( length > 0 ) {
+		ssize_t n = write( STDOUT_FILENO, data, length );
+
+		if ( n < 0 ) {
+			if ( errno == EINTR ) continue;
+			return;
+		}
+
+		data += n;
+		length -= n;
+	}
+}
+
+/*
+ *	Appends bytes to the frame output buffer.
+ */
+static void append( const char * data, int length ) {
+	if ( out_length + length > out_capacity ) {
+		int capacity = out_capacity > 0 ? out_capacity : 4096;
+
+		while ( capacity < out_length + length ) capacity *= 2;
+
+		char * buffer = realloc( out_buffer, capacity );
+
+		if ( buffer == NULL ) return;
+
+		out_buffer = buffer;
+		out_capacity = capacity;
+	}
+
+	memcpy( out_buffer + out_length, data, length );
+	out_length += length;
+}
+
+static void append_string( const char * text ) {
+	append( text, strlen( text ) );
+}
+
+/*
+ *	Writes the sequence which moves the cursor n cells in a direction
+ *	(one of the final characters A, B, C, D) into sequence, using single
+ *	control characters where they are shorter. Returns its length.
+ */
+static int relative_move( char * sequence, int n, char direction ) {
+	if ( n <= 0 ) return 0;
+
+	// Line feed moves straight down (newline translation is off), backspace left.
+	char single = direction == 'B' ? '\n' : direction == 'D' ? '\b' : 0;
+
+	if ( single && n <= 3 ) {
+		memset( sequence, single, n );
+		return n;
+	}
+
+	if ( n == 1 ) return sprintf( sequence, ESC "[%c", direction );
+
+	return sprintf( sequence, ESC "[%d%c", n, direction );
+}
+
+/*
+ *	Appends the shortest sequence that moves the cursor to (x,y): nothing
+ *	if it is already there, a move relative to the current position (or to
+ *	the start of the current row), or an absolute move.
+ */
+static void move_cursor( int x, int y ) {
+	char best[32];
+	char relative[32];
+	int length;
+
+	if ( y == cursor_y && x == cursor_x ) return;
+
+	if ( x == 0 ) {
+		length = sprintf( best, ESC "[%dH", y + 1 );
+	} else {
+		length = sprintf( best, ESC "[%d;%dH", y + 1, x + 1 );
+	}
+
+	if ( cursor_y >= 0 && cursor_x >= 0 ) {
+		// Vertical part, then horizontal part from the current column.
+		int n = ( y >= cursor_y )
+			? relative_move( relative, y - cursor_y, 'B' )
+			: relative_move( relative, cursor_y - y, 'A' );
+		int v = n;
+
+		n += ( x >= cursor_x )
+			? relative_move( relative + n, x - cursor_x, 'C' )
+			: relative_move( relative + n, cursor_x - x, 'D' );
+
+		if ( n < length ) {
+			memcpy( best, relative, n );
+			length = n;
+		}
+
+		// Vertical part, then carriage return and horizontal part from column 0.
+		n = v;
+		relative[n++] = '\r';
+		n += relative_move( relative + n, x, 'C' );
+
+		if ( n < length ) {
+			memcpy( best, relative, n );
+			length = n;
+		}
+	}
+
+	append( best, length );
+	cursor_x = x;
+	cursor_y = y;
+}
+
+/*
+ *	Starts a frame, if the output buffer is empty.
+ */
+static void begin_frame( void ) {
+	if ( out_length == 0 && sync_update ) {
+		append_string( SYNC_BEGIN );
+	}
+}
+
+/*
+ *	Signal handler noting that the terminal has been resized.
+ */
+static void on_resize( int signal ) {
+	resized = true;
+}
+
+/*
+ *	Signal handler which restores the terminal before the program is
+ *	interrupted, as ncurses does.
+ */
+static void on_interrupt( int signal ) {
+	const char * leave = ESC "[?25h" ESC "[?1049l";
+	write_all( leave, strlen( leave ) );
+
+	if ( termios_saved ) {
+		tcsetattr( STDIN_FILENO, TCSAFLUSH, &saved_termios );
+	}
+
+	raise( signal );
+}
+
+/*
+ *	Reads the terminal size if it may have changed.
+ */
+static void update_size( void ) {
+	if ( !resized ) return;
+
+	resized = false;
+
+	struct winsize size;
+
+	if ( ioctl( STDOUT_FILENO, TIOCGWINSZ, &size ) == 0 && size.ws_col > 0 && size.ws_row > 0 ) {
+		term_width = size.ws_col;
+		term_height = size.ws_row;
+	}
+}
+
+/*
+ *	Waits up to timeout milliseconds (-1 for ever) for input, then reads
+ *	whatever is available into the input buffer. Returns false if nothing
+ *	was read.
+ */
+static bool fill_input( int timeout ) {
+	if ( in_length >= INPUT_BUFFER_SIZE ) return true;
+
+	struct pollfd fd = { STDIN_FILENO, POLLIN, 0 };
+
+	if ( poll( &fd, 1, timeout ) <= 0 ) return false;
+
+	ssize_t n = read( STDIN_FILENO, in_buffer + in_length, INPUT_BUFFER_SIZE - in_length );
+
+	if ( n <= 0 ) return false;
+
+	in_length += n;
+	return true;
+}
+
+/*
+ *	Removes the first count bytes from the input buffer.
+ */
+static void consume_input( int count ) {
+	memmove( in_buffer, in_buffer + count, in_length - count );
+	in_length -= count;
+}
+
+/*
+ *	Returns the key for the body of an escape sequence (after ESC [ or ESC O,
+ *	through the final byte), or ANSI_ERR if it is not one curses names.
+ *	Modified keys (ESC [ 1 ; 5 A) have their own curses codes, so are not
+ *	mapped to the plain ones.
+ */
+static int decode_sequence( const unsigned char * body, int length ) {
+	int final = body[length - 1];
+
+	if ( length == 1 || ( length == 2 && body[0] == '1' ) ) {
+		switch ( final ) {
+			case 'A': return ANSI_KEY_UP;
+			case 'B': return ANSI_KEY_DOWN;
+			case 'C': return ANSI_KEY_RIGHT;
+			case 'D': return ANSI_KEY_LEFT;
+			case 'H': return ANSI_KEY_HOME;
+			case 'F': return ANSI_KEY_END;
+		}
+	}
+
+	if ( length == 2 && final == '~' ) {
+		switch ( body[0] ) {
+			case '1': case '7': return ANSI_KEY_HOME;
+			case '2': return ANSI_KEY_IC;
+			case '3': return ANSI_KEY_DC;
+			case '4': case '8': return ANSI_KEY_END;
+			case '5': return ANSI_KEY_PPAGE;
+			case '6': return ANSI_KEY_NPAGE;
+		}
+	}
+
+	return ANSI_ERR;
+}
+
+/*
+ *	Asks the terminal whether it supports synchronized output, unless
+ *	ZDK_ANSI_SYNC says otherwise. A supporting terminal answers
+ *	ESC [ ? 2026 ; Ps $ y with Ps 1 or 2; others do not answer at all.
+ */
+static bool detect_sync_update( void ) {
+	const char * setting = getenv( "ZDK_ANSI_SYNC" );
+
+	if ( setting != NULL ) {
+		return setting[0] == '1';
+	}
+
+	if ( !isatty( STDIN_FILENO ) || !isatty( STDOUT_FILENO ) ) return false;
+
+	const char * query = ESC "[?2026$p";
+	write_all( query, strlen( query ) );
+
+	const char * reply = ESC "[?2026;";
+	int reply_length = strlen( reply );
+
+	while ( in_length < INPUT_BUFFER_SIZE && fill_input( ANSI_QUERY_DELAY ) ) {
+		for ( int i = 0; i + reply_length + 2 < in_length; i++ ) {
+			if ( memcmp( in_buffer + i, reply, reply_length ) == 0 ) {
+				int status = in_buffer[i + reply_length];
+				int end = i + reply_length + 1;
+
+				while ( end < in_length && in_buffer[end] != 'y' ) end++;
+
+				if ( end >= in_length ) break;
+
+				// Drop the reply but keep any keys typed around it.
+				memmove( in_buffer + i, in_buffer + end + 1, in_length - end - 1 );
+				in_length -= end + 1 - i;
+				return status == '1' || status == '2';
+			}
+		}
+	}
+
+	return false;
+}
+
+/**
+ *	Puts the terminal into raw mode and switches to the alternate screen.
+ */
+void backend_setup( void ) {
+	if ( active ) return;
+
+	if ( tcgetattr( STDIN_FILENO, &saved_termios ) == 0 ) {
+		struct termios raw = saved_termios;
+		raw.c_lflag &= ~( ICANON | ECHO );
+		raw.c_iflag &= ~IXON;
+		raw.c_oflag &= ~ONLCR;
+		raw.c_cc[VMIN] = 0;
+		raw.c_cc[VTIME] = 0;
+		tcsetattr( STDIN_FILENO, TCSAFLUSH, &raw );
+		termios_saved = true;
+	}
+
+	struct sigaction action;
+	memset( &action, 0, sizeof( action ) );
+	action.sa_handler = on_resize;
+	sigaction( SIGWINCH, &action, NULL );
+
+	action.sa_handler = on_interrupt;
+	action.sa_flags = SA_RESETHAND;
+	sigaction( SIGINT, &action, NULL );
+	sigaction( SIGTERM, &action, NULL );
+	resized = true;
+	update_size();
+
+	// Alternate screen, hidden cursor, cleared display.
+	const char * enter = ESC "[?1049h" ESC "[?25l" ESC "[H" ESC "[2J";
+	write_all( enter, strlen( enter ) );
+	cursor_x = cursor_y = -1;
+
+	sync_update = detect_sync_update();
+	active = true;
+}
+
+/**
+ *	Restores the terminal to its normal operational state.
+ */
+void backend_cleanup( void ) {
+	if ( !active ) return;
+
+	backend_refresh();
+
+	const char * leave = ESC "[?25h" ESC "[?1049l";
+	write_all( leave, strlen( leave ) );
+
+	if ( termios_saved ) {
+		tcsetattr( STDIN_FILENO, TCSAFLUSH, &saved_termios );
+		termios_saved = false;
+	}
+
+	signal( SIGWINCH, SIG_DFL );
+	signal( SIGINT, SIG_DFL );
+	signal( SIGTERM, SIG_DFL );
+	free( out_buffer );
+	out_buffer = NULL;
+	out_length = out_capacity = 0;
+	active = false;
+}
+
+int backend_width( void ) {
+	update_size();
+	return term_width;
+}
+
+int backend_height( void ) {
+	update_size();
+	return term_height;
+}
+
+void backend_clear( void ) {
+	begin_frame();
+	append_string( ESC "[H" ESC "[2J" );
+	cursor_x = 0;
+	cursor_y = 0;
+}
+
+void backend_put( int x, int y, const char * text, int length ) {
+	begin_frame();
+	move_cursor( x, y );
+
+	// Trailing blanks (typically something erased) are cleared with ECH,
+	// which is shorter for longer runs and leaves the cursor where it is.
+	int blanks = 0;
+	while ( blanks < length && text[length - 1 - blanks] == ' ' ) blanks++;
+
+	char erase[16];
+	int erase_length = sprintf( erase, ESC "[%dX", blanks );
+
+	if ( blanks > 0 && erase_length < blanks ) {
+		append( text, length - blanks );
+		append( erase, erase_length );
+		cursor_x = x + length - blanks;
+		return;
+	}
+
+	append( text, length );
+	cursor_x = x + length;
+
+	if ( cursor_x >= term_width ) {
+		// Writing the last column leaves the cursor position terminal-dependent.
+		cursor_x = cursor_y = -1;
+	}
+}
+
+void backend_refresh( void ) {
+	if ( out_length == 0 ) return;
+
+	if ( sync_update ) {
+		append_string( SYNC_END );
+	}
+
+	write_all( out_buffer, out_length );
+	out_length = 0;
+}
+
+bool backend_wait_input( timer_ns deadline ) {
+	return in_length > 0 || timer_wait_fd( STDIN_FILENO, deadline );
+}
+
+int backend_read_char( bool wait ) {
+	if ( in_length == 0 && !fill_input( wait ? -1 : 0 ) ) {
+		return ANSI_ERR;
+	}
+
+	int key = in_buffer[0];
+
+	if ( key != 27 ) {
+		consume_input( 1 );
+		return key;
+	}
+
+	// ESC may start a key sequence: ESC O A, or a control sequence
+	// ESC [ params final, where final is in 0x40-0x7E.
+	if ( in_length < 2 ) {
+		fill_input( ANSI_ESCAPE_DELAY );
+	}
+
+	if ( in_length < 2 || ( in_buffer[1] != '[' && in_buffer[1] != 'O' ) ) {
+		consume_input( 1 );
+		return key;
+	}
+
+	int length = 2;
+
+	if ( in_buffer[1] == 'O' ) {
+		if ( in_length < 3 ) fill_input( ANSI_ESCAPE_DELAY );
+		length = 3;
+	}
+	else {
+		while ( true ) {
+			while ( length < in_length && ( in_buffer[length] < 0x40 || in_buffer[length] > 0x7E ) ) length++;
+
+			if ( length < in_length || in_length >= INPUT_BUFFER_SIZE || !fill_input( ANSI_ESCAPE_DELAY ) ) break;
+		}
+
+		length++;
+	}
+
+	if ( length > in_length ) {
+		// The rest never arrived: drop what there is rather than pass it on as keys.
+		consume_input( in_length );
+		return backend_read_char( wait );
+	}
+
+	key = decode_sequence( in_buffer + 2, length - 2 );
+	consume_input( length );
+
+	// Sequences for keys curses does not name are discarded whole.
+	return key == ANSI_ERR ? backend_read_char( wait ) : key;
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+/*
+ *	cab202_backend.h
+ *
+ *	Interface between the device-independent parts of the ZDK graphics
+ *	library (cab202_graphics.c) and a display backend. Exactly one backend
+ *	is linked into each build of the library:
+ *
+ *		cab202_curses.c		- ncurses terminal (libzdk.a)
+ *		cab202_headless.c	- in-memory, no terminal (libzdk_headless.a)
+ *		cab202_ansi.c		- terminal driven with ANSI escapes (libzdk_ansi.a)
+ *
+ *	All drawing is done by cab202_graphics.c into an off-screen buffer. The
+ *	backend only has to present runs of changed cells and deliver input.
+ */
+
+#ifndef __CAB202_BACKEND_H__
+#define __CAB202_BACKEND_H__
+
+#include <stdbool.h>
+#include "cab202_timers.h"
+
+/*
+ *	Prepares the display for use. May be called more than once.
+ */
+void backend_setup( void );
+
+/*
+ *	Restores the display to its normal state.
+ */
+void backend_cleanup( void );
+
+/*
+ *	Returns the width of the physical display, in characters.
+ */
+int backend_width( void );
+
+/*
+ *	Returns the height of the physical display, in characters.
+ */
+int backend_height( void );
+
+/*
+ *	Erases the whole physical display.
+ */
+void backend_clear( void );
+
+/*
+ *	Writes length characters of text to the display, starting at (x,y).
+ *	The run never extends past the right edge of the display.
+ */
+void backend_put( int x, int y, const char * text, int length );
+
+/*
+ *	Makes everything written by backend_put visible.
+ */
+void backend_refresh( void );
+
+/*
+ *	Returns the next character from the input stream. If wait is false and no
+ *	character is available, returns ERR (-1) immediately.
+ */
+int backend_read_char( bool wait );
+
+/*
+ *	Waits until backend_read_char has a character to return, or the
+ *	monotonic clock reaches deadline. Returns true if a character is ready.
+ */
+bool backend_wait_input( timer_ns deadline );
+
+#endif
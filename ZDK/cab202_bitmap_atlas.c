@@ -0,0 +1,378 @@
+/*
+ *	cab202_bitmap_atlas.c
+ *
+ *	Interned, reference-counted sprite images. See cab202_bitmap_atlas.h.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "cab202_bitmap_atlas.h"
+
+/*
+ *	Size of an arena block. Larger images get a block to themselves.
+ */
+#define ATLAS_BLOCK_SIZE 65536
+
+/*
+ *	Alignment of each part of an image within the arena.
+ */
+#define ATLAS_ALIGN 8
+#define ALIGN_UP(n) ( ( (n) + ATLAS_ALIGN - 1 ) & ~(size_t) ( ATLAS_ALIGN - 1 ) )
+
+/*
+ *	Hash table markers. Other values are entry indices plus one.
+ */
+#define SLOT_EMPTY 0
+#define SLOT_DELETED (-1)
+
+/*
+ *	An image in the atlas. Its runs and characters occupy capacity bytes
+ *	of the arena, starting at row_spans.
+ */
+typedef struct Atlas_Entry {
+	int width;
+	int height;
+	int refs;
+	unsigned hash;
+	size_t capacity;
+	int * row_spans;
+	sprite_span * spans;
+	char * data;
+} Atlas_Entry;
+
+/*
+ *	A block of the arena. Blocks are only freed when the program exits.
+ */
+typedef struct Atlas_Block {
+	struct Atlas_Block * next;
+	size_t size;
+	size_t used;
+	char data[];
+} Atlas_Block;
+
+static pthread_mutex_t atlas_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static Atlas_Entry * entries = NULL;
+static int entry_count = 0;
+static int entry_capacity = 0;
+static int unused_count = 0; // entries with no references
+
+static int * table = NULL;
+static int table_size = 0;
+static int table_load = 0; // occupied or deleted slots
+
+static Atlas_Block * blocks = NULL;
+static size_t arena_bytes = 0;
+
+/*
+ *	FNV-1a hash of the size and characters of an image.
+ */
+static unsigned hash_image( int width, int height, const char * data ) {
+	unsigned hash = 2166136261u;
+	int size[2] = { width, height };
+	const unsigned char * bytes = (const unsigned char *) size;
+
+	for ( size_t i = 0; i < sizeof( size ); i++ ) {
+		hash = ( hash ^ bytes[i] ) * 16777619u;
+	}
+
+	for ( int i = 0; i < width * height; i++ ) {
+		hash = ( hash ^ (unsigned char) data[i] ) * 16777619u;
+	}
+
+	return hash;
+}
+
+/*
+ *	Returns the entry for a handle.
+ */
+static Atlas_Entry * entry_of( bitmap_id id ) {
+	assert( id > 0 && id <= entry_count );
+	return &entries[id - 1];
+}
+
+/*
+ *	Returns the hash table slot holding an identical image, or the slot
+ *	where it should be inserted if there is none.
+ */
+static int find_slot( unsigned hash, int width, int height, const char * data ) {
+	int mask = table_size - 1;
+	int insert = -1;
+
+	for ( int i = hash & mask; ; i = ( i + 1 ) & mask ) {
+		int slot = table[i];
+
+		if ( slot == SLOT_EMPTY ) {
+			return insert >= 0 ? insert : i;
+		}
+
+		if ( slot == SLOT_DELETED ) {
+			if ( insert < 0 ) insert = i;
+			continue;
+		}
+
+		Atlas_Entry * e = &entries[slot - 1];
+
+		if ( e->hash == hash && e->width == width && e->height == height
+			&& memcmp( e->data, data, width * height ) == 0 ) {
+			return i;
+		}
+	}
+}
+
+/*
+ *	Rebuilds the hash table with room for at least twice the entries.
+ */
+static bool grow_table( void ) {
+	int size = table_size > 0 ? table_size : 64;
+
+	while ( size < 4 * ( entry_count + 1 ) ) size *= 2;
+
+	int * new_table = calloc( size, sizeof( int ) );
+
+	if ( new_table == NULL ) return false;
+
+	free( table );
+	table = new_table;
+	table_size = size;
+	table_load = 0;
+
+	for ( int i = 0; i < entry_count; i++ ) {
+		Atlas_Entry * e = &entries[i];
+
+		if ( e->data == NULL ) continue;
+
+		int slot = find_slot( e->hash, e->width, e->height, e->data );
+		table[slot] = i + 1;
+		table_load++;
+	}
+
+	return true;
+}
+
+/*
+ *	Takes size bytes from the arena, or returns NULL.
+ */
+static void * arena_alloc( size_t size ) {
+	if ( blocks == NULL || blocks->size - blocks->used < size ) {
+		size_t block_size = size > ATLAS_BLOCK_SIZE ? size : ATLAS_BLOCK_SIZE;
+		Atlas_Block * block = malloc( sizeof( Atlas_Block ) + block_size );
+
+		if ( block == NULL ) return NULL;
+
+		block->next = blocks;
+		block->size = block_size;
+		block->used = 0;
+		blocks = block;
+		arena_bytes += block_size;
+	}
+
+	void * result = blocks->data + blocks->used;
+	blocks->used += size;
+	return result;
+}
+
+/*
+ *	Finds storage of at least capacity bytes for a new image: an unused
+ *	entry that is large enough, or a new entry with fresh arena space.
+ *	Returns NULL if memory could not be allocated.
+ */
+static Atlas_Entry * allocate_entry( size_t capacity ) {
+	for ( int i = 0; unused_count > 0 && i < entry_count; i++ ) {
+		Atlas_Entry * e = &entries[i];
+
+		if ( e->refs == 0 && e->capacity >= capacity ) {
+			if ( e->data != NULL ) {
+				// Forget the old image.
+				int slot = find_slot( e->hash, e->width, e->height, e->data );
+				table[slot] = SLOT_DELETED;
+			}
+
+			unused_count--;
+			return e;
+		}
+	}
+
+	if ( entry_count >= entry_capacity ) {
+		int new_capacity = entry_capacity > 0 ? 2 * entry_capacity : 64;
+		Atlas_Entry * new_entries = realloc( entries, new_capacity * sizeof( Atlas_Entry ) );
+
+		if ( new_entries == NULL ) return NULL;
+
+		entries = new_entries;
+		entry_capacity = new_capacity;
+	}
+
+	void * space = arena_alloc( capacity );
+
+	if ( space == NULL ) return NULL;
+
+	Atlas_Entry * e = &entries[entry_count++];
+	memset( e, 0, sizeof( Atlas_Entry ) );
+	e->capacity = capacity;
+	e->row_spans = space;
+	return e;
+}
+
+/**
+ *	Adds an image to the atlas, or finds the identical image already there.
+ */
+bitmap_id bitmap_intern( int width, int height, const char * data ) {
+	assert( width > 0 );
+	assert( height > 0 );
+	assert( data != NULL );
+
+	unsigned hash = hash_image( width, height, data );
+	bitmap_id result = NO_BITMAP;
+
+	pthread_mutex_lock( &atlas_lock );
+
+	if ( 2 * ( table_load + 1 ) > table_size && !grow_table() ) {
+		pthread_mutex_unlock( &atlas_lock );
+		return NO_BITMAP;
+	}
+
+	int slot = find_slot( hash, width, height, data );
+
+	if ( table[slot] > 0 ) {
+		// Already interned.
+		result = table[slot];
+
+		if ( entries[result - 1].refs++ == 0 ) unused_count--;
+		pthread_mutex_unlock( &atlas_lock );
+		return result;
+	}
+
+	int runs = sprite_find_runs( data, width, height, NULL, NULL );
+	size_t rows_size = ALIGN_UP( ( height + 1 ) * sizeof( int ) );
+	size_t runs_size = ALIGN_UP( runs * sizeof( sprite_span ) );
+	size_t capacity = rows_size + runs_size + ALIGN_UP( width * height );
+	Atlas_Entry * e = allocate_entry( capacity );
+
+	if ( e != NULL ) {
+		char * base = (char *) e->row_spans;
+		e->width = width;
+		e->height = height;
+		e->refs = 1;
+		e->hash = hash;
+		e->spans = (sprite_span *) ( base + rows_size );
+		e->data = base + rows_size + runs_size;
+		memcpy( e->data, data, width * height );
+		sprite_find_runs( e->data, width, height, e->row_spans, e->spans );
+
+		// The slot may have moved if an old image was forgotten.
+		slot = find_slot( hash, width, height, data );
+
+		if ( table[slot] == SLOT_EMPTY ) table_load++;
+
+		result = e - entries + 1;
+		table[slot] = result;
+	}
+
+	pthread_mutex_unlock( &atlas_lock );
+	return result;
+}
+
+/**
+ *	Takes another reference to an image.
+ */
+void bitmap_retain( bitmap_id id ) {
+	if ( id == NO_BITMAP ) return;
+
+	pthread_mutex_lock( &atlas_lock );
+
+	if ( entry_of( id )->refs++ == 0 ) unused_count--;
+
+	pthread_mutex_unlock( &atlas_lock );
+}
+
+/**
+ *	Gives up a reference to an image.
+ */
+void bitmap_release( bitmap_id id ) {
+	if ( id == NO_BITMAP ) return;
+
+	pthread_mutex_lock( &atlas_lock );
+	Atlas_Entry * e = entry_of( id );
+	assert( e->refs > 0 );
+
+	if ( --e->refs == 0 ) unused_count++;
+	pthread_mutex_unlock( &atlas_lock );
+}
+
+char * bitmap_data( bitmap_id id ) {
+	pthread_mutex_lock( &atlas_lock );
+	char * data = entry_of( id )->data;
+	pthread_mutex_unlock( &atlas_lock );
+	return data;
+}
+
+int bitmap_width( bitmap_id id ) {
+	pthread_mutex_lock( &atlas_lock );
+	int width = entry_of( id )->width;
+	pthread_mutex_unlock( &atlas_lock );
+	return width;
+}
+
+int bitmap_height( bitmap_id id ) {
+	pthread_mutex_lock( &atlas_lock );
+	int height = entry_of( id )->height;
+	pthread_mutex_unlock( &atlas_lock );
+	return height;
+}
+
+void bitmap_runs( bitmap_id id, int ** row_spans, sprite_span ** spans ) {
+	pthread_mutex_lock( &atlas_lock );
+	Atlas_Entry * e = entry_of( id );
+	*row_spans = e->row_spans;
+	*spans = e->spans;
+	pthread_mutex_unlock( &atlas_lock );
+}
+
+void bitmap_atlas_stats( int * images, size_t * bytes ) {
+	pthread_mutex_lock( &atlas_lock );
+	int count = 0;
+
+	for ( int i = 0; i < entry_count; i++ ) {
+		if ( entries[i].refs > 0 ) count++;
+	}
+
+	*images = count;
+	*bytes = arena_bytes;
+	pthread_mutex_unlock( &atlas_lock );
+}
+
+/**
+ *	Makes a sprite show an image from the atlas. The sprite takes a
+ *	reference to the image and shares its characters and runs.
+ */
+void sprite_set_bitmap( sprite_id sprite, bitmap_id id ) {
+	assert( sprite != NULL );
+	assert( id != NO_BITMAP );
+
+	if ( sprite->image == id ) return;
+
+	pthread_mutex_lock( &atlas_lock );
+	Atlas_Entry * e = entry_of( id );
+
+	if ( e->refs++ == 0 ) unused_count--;
+
+	if ( sprite->image != NO_BITMAP ) {
+		if ( --entry_of( sprite->image )->refs == 0 ) unused_count++;
+	}
+	else {
+		free( sprite->spans );
+		free( sprite->row_spans );
+	}
+
+	sprite->image = id;
+	sprite->width = e->width;
+	sprite->height = e->height;
+	sprite->bitmap = e->data;
+	sprite->span_bitmap = e->data;
+	sprite->spans = e->spans;
+	sprite->row_spans = e->row_spans;
+	pthread_mutex_unlock( &atlas_lock );
+}
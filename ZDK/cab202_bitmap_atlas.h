@@ -0,0 +1,134 @@
+/*
+ *	cab202_bitmap_atlas.h
+ *
+ *	A store of sprite images, shared by every sprite that shows them.
+ *
+ *	Images are interned by size and content: asking for an image that is
+ *	already in the atlas returns the existing copy rather than storing
+ *	another. Each image is identified by a bitmap_id handle and counts the
+ *	references to it; its storage is reused once the count drops to zero.
+ *
+ *	The characters of every image, together with the opaque runs used to
+ *	draw it (see sprite_draw), are kept in large arena blocks rather than
+ *	separate allocations. Blocks are never moved, so the data of an image
+ *	stays at the same address for as long as the image is referenced.
+ *
+ *	The atlas may be used from several threads at once.
+ */
+
+#ifndef __CAB202_BITMAP_ATLAS_H__
+#define __CAB202_BITMAP_ATLAS_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "cab202_sprites.h"
+
+/*
+ *	Identifies an image in the atlas.
+ */
+typedef int bitmap_id;
+
+/*
+ *	Value denoting no image. Never returned by bitmap_intern.
+ */
+#define NO_BITMAP 0
+
+/*
+ *	bitmap_intern:
+ *
+ *	Adds an image to the atlas, or finds the identical image already there,
+ *	and takes a reference to it.
+ *
+ *	Input:
+ *		width, height: The dimensions of the image.
+ *		data: The characters of the image, row by row. ' ' (space) is
+ *			transparent. The atlas copies the characters.
+ *
+ *	Output:
+ *		Returns the image, or NO_BITMAP if memory could not be allocated.
+ */
+bitmap_id bitmap_intern( int width, int height, const char * data );
+
+/*
+ *	bitmap_retain:
+ *
+ *	Takes another reference to an image.
+ *
+ *	Input:
+ *		id: The image. NO_BITMAP is ignored.
+ */
+void bitmap_retain( bitmap_id id );
+
+/*
+ *	bitmap_release:
+ *
+ *	Gives up a reference to an image. When no references remain, the
+ *	storage of the image may be reused by a later call to bitmap_intern.
+ *
+ *	Input:
+ *		id: The image. NO_BITMAP is ignored.
+ */
+void bitmap_release( bitmap_id id );
+
+/*
+ *	bitmap_data:
+ *
+ *	Returns the characters of an image, row by row. The address stays
+ *	valid while the image is referenced. The characters must not be changed.
+ *
+ *	Input:
+ *		id: The image.
+ */
+char * bitmap_data( bitmap_id id );
+
+/*
+ *	bitmap_width, bitmap_height:
+ *
+ *	Return the dimensions of an image.
+ *
+ *	Input:
+ *		id: The image.
+ */
+int bitmap_width( bitmap_id id );
+int bitmap_height( bitmap_id id );
+
+/*
+ *	bitmap_runs:
+ *
+ *	Returns the opaque runs of an image, laid out as the spans and
+ *	row_spans members of sprite_t.
+ *
+ *	Input:
+ *		id: The image.
+ *		row_spans: Set to the index of the first run on each row, followed
+ *			by the total number of runs.
+ *		spans: Set to the runs.
+ */
+void bitmap_runs( bitmap_id id, int ** row_spans, sprite_span ** spans );
+
+/*
+ *	bitmap_atlas_stats:
+ *
+ *	Reports the contents of the atlas.
+ *
+ *	Output:
+ *		images: The number of images with at least one reference.
+ *		bytes: The total size of the arena blocks.
+ */
+void bitmap_atlas_stats( int * images, size_t * bytes );
+
+/*
+ *	sprite_set_bitmap:
+ *
+ *	Makes a sprite show an image from the atlas, taking its size from the
+ *	image. The sprite shares the characters and opaque runs of the image
+ *	and holds a reference to it until it is given another image or
+ *	destroyed. Setting the image a sprite already shows costs nothing.
+ *
+ *	Input:
+ *		sprite: The sprite.
+ *		id: The image. Must not be NO_BITMAP.
+ */
+void sprite_set_bitmap( sprite_id sprite, bitmap_id id );
+
+#endif
@@ -0,0 +1,378 @@
+/*
+ *	cab202_capture.c
+ *
+ *	Binary delta screen capture, written by a background thread.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include "cab202_capture.h"
+#include "cab202_timers.h"
+
+/*
+ *	Once the active buffer holds this many bytes it is handed to the writer.
+ */
+#define CAPTURE_FLUSH_SIZE ( 64 * 1024 )
+
+/*
+ *	Growable byte buffer used to encode records.
+ */
+typedef struct Capture_Buffer {
+	unsigned char * data;
+	size_t length;
+	size_t capacity;
+} Capture_Buffer;
+
+/*
+ *	Capture state. The encoder owns buffers[active]; while writer_busy is
+ *	true the writer thread owns the other buffer.
+ */
+static int capture_fd = -1;
+static int keyframe_interval = CAPTURE_DEFAULT_KEYFRAME_INTERVAL;
+static Capture_Buffer buffers[2];
+static int active = 0;
+static bool writer_busy = false;
+static bool writer_stopping = false;
+static pthread_t writer_thread;
+static pthread_mutex_t writer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writer_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t writer_idle = PTHREAD_COND_INITIALIZER;
+
+/*
+ *	The previously captured frame, against which deltas are computed.
+ */
+static char * previous = NULL;
+static int previous_width = 0;
+static int previous_height = 0;
+static long frames_since_keyframe = 0;
+
+static capture_stats stats;
+
+/*
+ *	Returns a monotonic time in seconds, for measuring encoding cost.
+ */
+static double capture_clock( void ) {
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return now.tv_sec + now.tv_nsec / 1.0e+9;
+}
+
+/*
+ *	Makes room for at least extra more bytes in a buffer. Returns false, and
+ *	leaves the buffer as it was, if the memory cannot be allocated.
+ */
+static bool reserve( Capture_Buffer * buffer, size_t extra ) {
+	if ( buffer->length + extra <= buffer->capacity ) return true;
+
+	size_t capacity = buffer->capacity == 0 ? 2 * CAPTURE_FLUSH_SIZE : buffer->capacity;
+
+	while ( buffer->length + extra > capacity ) capacity *= 2;
+
+	unsigned char * data = realloc( buffer->data, capacity );
+
+	if ( data == NULL ) return false;
+
+	buffer->data = data;
+	buffer->capacity = capacity;
+	return true;
+}
+
+static void put_u8( Capture_Buffer * buffer, unsigned value ) {
+	buffer->data[buffer->length++] = value & 0xff;
+}
+
+static void put_u16( Capture_Buffer * buffer, unsigned value ) {
+	put_u8( buffer, value );
+	put_u8( buffer, value >> 8 );
+}
+
+static void put_u32( Capture_Buffer * buffer, uint32_t value ) {
+	put_u16( buffer, value & 0xffff );
+	put_u16( buffer, value >> 16 );
+}
+
+static void put_f64( Capture_Buffer * buffer, double value ) {
+	uint64_t bits;
+	memcpy( &bits, &value, sizeof( bits ) );
+	put_u32( buffer, (uint32_t) bits );
+	put_u32( buffer, (uint32_t) ( bits >> 32 ) );
+}
+
+static void put_varint( Capture_Buffer * buffer, uint32_t value ) {
+	while ( value >= 0x80 ) {
+		put_u8( buffer, ( value & 0x7f ) | 0x80 );
+		value >>= 7;
+	}
+
+	put_u8( buffer, value );
+}
+
+/*
+ *	Overwrites the u32 payload size of the record starting at offset start.
+ */
+static void end_record( Capture_Buffer * buffer, size_t start ) {
+	uint32_t size = buffer->length - start - CAPTURE_RECORD_HEADER_SIZE;
+	unsigned char * p = buffer->data + start + 1;
+	p[0] = size & 0xff;
+	p[1] = ( size >> 8 ) & 0xff;
+	p[2] = ( size >> 16 ) & 0xff;
+	p[3] = ( size >> 24 ) & 0xff;
+}
+
+/*
+ *	Starts a record with the given tag; the payload size is filled in by end_record.
+ */
+static size_t begin_record( Capture_Buffer * buffer, int tag ) {
+	size_t start = buffer->length;
+	put_u8( buffer, tag );
+	put_u32( buffer, 0 );
+	return start;
+}
+
+/*
+ *	Writes a whole buffer to the capture file, retrying after partial writes.
+ */
+static void write_all( const unsigned char * data, size_t length ) {
+	while ( length > 0 ) {
+		ssize_t written = write( capture_fd, data, length );
+
+		if ( written <= 0 ) return;
+
+		data += written;
+		length -= written;
+	}
+}
+
+/*
+ *	Body of the writer thread. Waits for full buffers and writes them out.
+ */
+static void * writer_main( void * unused ) {
+	pthread_mutex_lock( &writer_lock );
+
+	for ( ;; ) {
+		while ( !writer_busy && !writer_stopping ) {
+			pthread_cond_wait( &writer_wake, &writer_lock );
+		}
+
+		if ( !writer_busy ) break;
+
+		Capture_Buffer * buffer = &buffers[1 - active];
+		pthread_mutex_unlock( &writer_lock );
+
+		write_all( buffer->data, buffer->length );
+		buffer->length = 0;
+
+		pthread_mutex_lock( &writer_lock );
+		writer_busy = false;
+		pthread_cond_signal( &writer_idle );
+	}
+
+	pthread_mutex_unlock( &writer_lock );
+	return unused;
+}
+
+/*
+ *	Hands the active buffer to the writer thread if it is idle. If the writer
+ *	is still busy the encoder simply keeps appending to the active buffer,
+ *	so a slow disk never stalls a frame.
+ */
+static void hand_off( bool force ) {
+	pthread_mutex_lock( &writer_lock );
+
+	if ( force ) {
+		while ( writer_busy ) pthread_cond_wait( &writer_idle, &writer_lock );
+	}
+
+	if ( !writer_busy && buffers[active].length > 0 ) {
+		active = 1 - active;
+		writer_busy = true;
+		pthread_cond_signal( &writer_wake );
+	}
+
+	pthread_mutex_unlock( &writer_lock );
+}
+
+bool start_capture( const char * file_name, int interval ) {
+	stop_capture();
+
+	capture_fd = open( file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+
+	if ( capture_fd < 0 ) return false;
+
+	keyframe_interval = interval > 0 ? interval : CAPTURE_DEFAULT_KEYFRAME_INTERVAL;
+	memset( &stats, 0, sizeof( stats ) );
+	active = 0;
+	writer_busy = false;
+	writer_stopping = false;
+	previous_width = previous_height = 0;
+
+	if ( pthread_create( &writer_thread, NULL, writer_main, NULL ) != 0 ) {
+		close( capture_fd );
+		capture_fd = -1;
+		return false;
+	}
+
+	return true;
+}
+
+void stop_capture( void ) {
+	if ( capture_fd < 0 ) return;
+
+	hand_off( true );
+
+	pthread_mutex_lock( &writer_lock );
+	writer_stopping = true;
+	pthread_cond_signal( &writer_wake );
+	pthread_mutex_unlock( &writer_lock );
+	pthread_join( writer_thread, NULL );
+
+	close( capture_fd );
+	capture_fd = -1;
+
+	free( previous );
+	previous = NULL;
+}
+
+bool capture_active( void ) {
+	return capture_fd >= 0;
+}
+
+capture_stats get_capture_stats( void ) {
+	return stats;
+}
+
+/*
+ *	Appends a keyframe holding the whole of cells.
+ */
+static void put_keyframe( Capture_Buffer * buffer, const char * cells, int width, int height, double time ) {
+	size_t start = begin_record( buffer, CAPTURE_KEYFRAME );
+	put_f64( buffer, time );
+	put_u32( buffer, stats.frames );
+	put_u16( buffer, width );
+	put_u16( buffer, height );
+	memcpy( buffer->data + buffer->length, cells, width * height );
+	buffer->length += width * height;
+	end_record( buffer, start );
+	stats.keyframes++;
+}
+
+/*
+ *	Appends a delta holding the runs of cells which differ from the previous frame.
+ *	Returns false, leaving the buffer unchanged, if the delta would not be
+ *	smaller than a keyframe.
+ */
+static bool put_delta( Capture_Buffer * buffer, const char * cells, int size, double time ) {
+	size_t start = begin_record( buffer, CAPTURE_DELTA );
+	put_f64( buffer, time );
+	put_u32( buffer, stats.frames );
+
+	// Count the runs first, so the count can precede them.
+	uint32_t runs = 0;
+
+	for ( int i = 0; i < size; ) {
+		while ( i < size && cells[i] == previous[i] ) i++;
+		if ( i >= size ) break;
+		runs++;
+		while ( i < size && cells[i] != previous[i] ) i++;
+	}
+
+	put_varint( buffer, runs );
+
+	int end = 0;
+
+	for ( int i = 0; i < size; ) {
+		while ( i < size && cells[i] == previous[i] ) i++;
+		if ( i >= size ) break;
+
+		int run = i;
+		while ( i < size && cells[i] != previous[i] ) i++;
+
+		put_varint( buffer, run - end );
+		put_varint( buffer, i - run );
+		memcpy( buffer->data + buffer->length, cells + run, i - run );
+		buffer->length += i - run;
+		end = i;
+	}
+
+	if ( buffer->length - start >= (size_t) size + 4 ) {
+		buffer->length = start;
+		return false;
+	}
+
+	end_record( buffer, start );
+	return true;
+}
+
+void capture_frame( const char * cells, int width, int height ) {
+	if ( capture_fd < 0 || cells == NULL ) return;
+
+	double started = capture_clock();
+	Capture_Buffer * buffer = &buffers[active];
+	size_t before = buffer->length;
+	int size = width * height;
+
+	// Worst case for a delta is one run per two cells, each with two short varints.
+	// Out of memory, the frame is skipped; the next is encoded against the last one kept.
+	if ( !reserve( buffer, CAPTURE_HEADER_SIZE + 64 + 4 * (size_t) size ) ) return;
+
+	if ( stats.frames == 0 ) {
+		// First frame: write the file header.
+		memcpy( buffer->data + buffer->length, CAPTURE_MAGIC, 8 );
+		buffer->length += 8;
+		put_u16( buffer, width );
+		put_u16( buffer, height );
+		put_u16( buffer, keyframe_interval );
+		put_u16( buffer, 0 );
+	}
+
+	double time = get_current_time();
+	bool same_size = previous != NULL && width == previous_width && height == previous_height;
+
+	if ( !same_size || frames_since_keyframe + 1 >= keyframe_interval
+		|| !put_delta( buffer, cells, size, time ) ) {
+		put_keyframe( buffer, cells, width, height, time );
+		frames_since_keyframe = 0;
+	}
+	else {
+		frames_since_keyframe++;
+	}
+
+	if ( !same_size ) {
+		free( previous );
+		previous = malloc( size );
+		previous_width = width;
+		previous_height = height;
+	}
+
+	if ( previous != NULL ) {
+		memcpy( previous, cells, size );
+	}
+	stats.frames++;
+	stats.bytes += buffer->length - before;
+
+	if ( buffer->length >= CAPTURE_FLUSH_SIZE ) {
+		hand_off( false );
+	}
+
+	stats.encode_seconds += capture_clock() - started;
+}
+
+void capture_key( int key ) {
+	if ( capture_fd < 0 || stats.frames == 0 ) return;
+
+	Capture_Buffer * buffer = &buffers[active];
+
+	if ( !reserve( buffer, 32 ) ) return;
+
+	size_t start = begin_record( buffer, CAPTURE_KEY );
+	put_f64( buffer, get_current_time() );
+	put_u32( buffer, (uint32_t) key );
+	end_record( buffer, start );
+	stats.keys++;
+	stats.bytes += buffer->length - start;
+}
@@ -0,0 +1,126 @@
+/*
+ *	cab202_capture.h
+ *
+ *	Binary screen capture for the ZDK graphics library. While a capture is
+ *	running, every call to show_screen appends the new frame to a file as a
+ *	delta against the previous frame, with a full keyframe at regular
+ *	intervals. Keys returned by get_char are captured as well.
+ *
+ *	Encoding is done in memory during show_screen. A background thread
+ *	writes completed buffers to a file descriptor which stays open for the
+ *	whole capture, so the cost per frame is a comparison of two cell
+ *	buffers and nothing more.
+ *
+ *	Setting the environment variable ZDK_CAPTURE to a file name makes
+ *	setup_screen start a capture automatically.
+ *
+ *	File format (all integers little-endian):
+ *
+ *		Header:	"ZDKCAP1\n", u16 width, u16 height, u16 keyframe interval, u16 0.
+ *
+ *		Records: u8 tag, u32 payload size, payload. The payloads are:
+ *
+ *		'K' keyframe:	f64 time, u32 frame number, u16 width, u16 height,
+ *						width * height cell bytes.
+ *		'D' delta:		f64 time, u32 frame number, varint run count, then for
+ *						each run: varint cells skipped since the end of the
+ *						previous run, varint run length, run bytes.
+ *		'C' key:		f64 time, i32 key code.
+ *
+ *		Varints are unsigned LEB128. A delta applies to the frame before it,
+ *		which has the dimensions of the most recent keyframe. Times are in
+ *		seconds, as returned by get_current_time.
+ */
+
+#ifndef __CAB202_CAPTURE_H__
+#define __CAB202_CAPTURE_H__
+
+#include <stdbool.h>
+
+/*
+ *	Capture file identification.
+ */
+#define CAPTURE_MAGIC "ZDKCAP1\n"
+#define CAPTURE_HEADER_SIZE 16
+#define CAPTURE_RECORD_HEADER_SIZE 5
+
+/*
+ *	Record tags.
+ */
+#define CAPTURE_KEYFRAME 'K'
+#define CAPTURE_DELTA 'D'
+#define CAPTURE_KEY 'C'
+
+/*
+ *	Number of frames between keyframes if none is specified.
+ */
+#define CAPTURE_DEFAULT_KEYFRAME_INTERVAL 100
+
+/*
+ *	Running totals for the current (or most recent) capture.
+ */
+typedef struct capture_stats {
+	long frames;			// frames captured
+	long keyframes;			// frames stored as keyframes
+	long keys;				// key presses captured
+	long bytes;				// bytes encoded, including the header
+	double encode_seconds;	// time spent encoding, on the caller's thread
+} capture_stats;
+
+/*
+ *	start_capture:
+ *
+ *	Begins capturing frames to a file, replacing any previous contents.
+ *	Any capture already running is stopped first.
+ *
+ *	Input:
+ *		file_name: The file to write.
+ *		keyframe_interval: The number of frames between keyframes, or 0
+ *			for CAPTURE_DEFAULT_KEYFRAME_INTERVAL.
+ *
+ *	Output:
+ *		Returns true if and only if the capture was started.
+ */
+bool start_capture( const char * file_name, int keyframe_interval );
+
+/*
+ *	stop_capture:
+ *
+ *	Writes any buffered data, waits for the writer thread and closes the file.
+ *	Does nothing if no capture is running.
+ */
+void stop_capture( void );
+
+/*
+ *	capture_active:
+ *
+ *	Returns true if and only if a capture is running.
+ */
+bool capture_active( void );
+
+/*
+ *	get_capture_stats:
+ *
+ *	Returns the totals for the current or most recent capture.
+ */
+capture_stats get_capture_stats( void );
+
+/*
+ *	capture_frame:
+ *
+ *	Appends a frame to the capture. Called by show_screen.
+ *
+ *	Input:
+ *		cells: The contents of the screen, row by row.
+ *		width, height: The dimensions of the screen.
+ */
+void capture_frame( const char * cells, int width, int height );
+
+/*
+ *	capture_key:
+ *
+ *	Appends a key press to the capture. Called by get_char.
+ */
+void capture_key( int key );
+
+#endif
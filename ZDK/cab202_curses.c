@@ -0,0 +1,82 @@
+/*
+ *	cab202_curses.c
+ *
+ *	ncurses display backend for the ZDK graphics library.
+ */
+
+#include <unistd.h>
+#include "cab202_backend.h"
+#include "curses.h"
+
+/**
+ *	Set up the terminal display for curses-based graphics.
+ */
+void backend_setup( void ) {
+	// Enter curses mode.
+	initscr();
+
+	// Do not echo keypresses.
+	noecho();
+
+	// Turn off the cursor.
+	curs_set( 0 );
+
+	// Cause getch to return ERR if no key pressed within 0 milliseconds.
+	timeout( 0 );
+
+	// Enable the keypad.
+	keypad( stdscr, TRUE );
+
+	// Erase any previous content that may be lingering in this screen.
+	clear();
+}
+
+/**
+*	Restore the terminal to its normal operational state.
+*/
+void backend_cleanup( void ) {
+	endwin();
+}
+
+int backend_width( void ) {
+	return getmaxx( stdscr );
+}
+
+int backend_height( void ) {
+	return getmaxy( stdscr );
+}
+
+void backend_clear( void ) {
+	clear();
+}
+
+void backend_put( int x, int y, const char * text, int length ) {
+	mvaddnstr( y, x, text, length );
+}
+
+void backend_refresh( void ) {
+	refresh();
+}
+
+int backend_read_char( bool wait ) {
+	if ( !wait ) {
+		return getch();
+	}
+
+	timeout( -1 );
+	int result = getch();
+	timeout( 0 );
+	return result;
+}
+
+bool backend_wait_input( timer_ns deadline ) {
+	// ncurses may already hold input read from the terminal.
+	int key = getch();
+
+	if ( key != ERR ) {
+		ungetch( key );
+		return true;
+	}
+
+	return timer_wait_fd( STDIN_FILENO, deadline );
+}
@@ -0,0 +1,71 @@
+/*
+ *	cab202_fixed.c
+ *
+ *	Q16.16 fixed-point functions. See cab202_fixed.h.
+ */
+
+#include "cab202_fixed.h"
+
+/*
+ *	sin( d degrees ) in Q16.16 for d = 0 .. 90, rounded to nearest.
+ *	Written out rather than computed, so no libm is involved.
+ */
+static const fixed quarter_sine[91] = {
+	0, 1144, 2287, 3430, 4572, 5712, 6850, 7987, 9121, 10252,
+	11380, 12505, 13626, 14742, 15855, 16962, 18064, 19161, 20252, 21336,
+	22415, 23486, 24550, 25607, 26656, 27697, 28729, 29753, 30767, 31772,
+	32768, 33754, 34729, 35693, 36647, 37590, 38521, 39441, 40348, 41243,
+	42126, 42995, 43852, 44695, 45525, 46341, 47143, 47930, 48703, 49461,
+	50203, 50931, 51643, 52339, 53020, 53684, 54332, 54963, 55578, 56175,
+	56756, 57319, 57865, 58393, 58903, 59396, 59870, 60326, 60764, 61183,
+	61584, 61966, 62328, 62672, 62997, 63303, 63589, 63856, 64104, 64332,
+	64540, 64729, 64898, 65048, 65177, 65287, 65376, 65446, 65496, 65526,
+	65536
+};
+
+/**
+ *	Returns the sine of an angle in whole degrees.
+ */
+fixed fixed_sin_deg( int degrees ) {
+	int d = degrees % 360;
+
+	if ( d < 0 ) d += 360;
+
+	if ( d <= 90 ) return quarter_sine[d];
+	if ( d <= 180 ) return quarter_sine[180 - d];
+	if ( d <= 270 ) return -quarter_sine[d - 180];
+	return -quarter_sine[360 - d];
+}
+
+/**
+ *	Returns the cosine of an angle in whole degrees.
+ */
+fixed fixed_cos_deg( int degrees ) {
+	return fixed_sin_deg( degrees % 360 + 90 );
+}
+
+/**
+ *	Returns the length of a vector, using a bitwise integer square root of
+ *	the 64-bit sum of squares (a Q32.32 value, whose root is Q16.16).
+ */
+fixed fixed_hypot( fixed dx, fixed dy ) {
+	uint64_t n = (uint64_t) ( (int64_t) dx * dx ) + (uint64_t) ( (int64_t) dy * dy );
+	uint64_t root = 0;
+	uint64_t bit = (uint64_t) 1 << 62;
+
+	while ( bit > n ) bit >>= 2;
+
+	while ( bit != 0 ) {
+		if ( n >= root + bit ) {
+			n -= root + bit;
+			root = ( root >> 1 ) + bit;
+		}
+		else {
+			root >>= 1;
+		}
+
+		bit >>= 2;
+	}
+
+	return root > INT32_MAX ? INT32_MAX : (fixed) root;
+}
@@ -0,0 +1,111 @@
+/*
+ *	cab202_fixed.h
+ *
+ *	Q16.16 fixed-point numbers, for simulations which must give exactly
+ *	the same results whatever the compiler, optimisation level or floating
+ *	point unit.
+ *
+ *	A fixed holds a signed value in 32 bits: 16 bits of whole part and 16
+ *	bits of fraction, giving a range of -32768 to 32768 in steps of 1/65536.
+ *	Addition, subtraction, comparison and multiplication or division by an
+ *	int use the ordinary integer operators. The functions below cover the
+ *	remaining operations, using integer arithmetic only. Trigonometry comes
+ *	from a table of sines, one entry per degree.
+ *
+ *	Negative values are shifted right arithmetically, as every supported
+ *	compiler does.
+ */
+
+#ifndef __CAB202_FIXED_H__
+#define __CAB202_FIXED_H__
+
+#include <stdint.h>
+
+/*
+ *	A Q16.16 fixed-point number.
+ */
+typedef int32_t fixed;
+
+#define FIXED_SHIFT 16
+#define FIXED_ONE ( (fixed) 1 << FIXED_SHIFT )
+
+/*
+ *	Converts a constant to the nearest fixed value. The argument should be
+ *	a constant expression, so the conversion is done by the compiler.
+ */
+#define FIXED(c) ( (fixed) ( (c) * FIXED_ONE + ( (c) < 0 ? -0.5 : 0.5 ) ) )
+
+/*
+ *	fixed_from_int:
+ *
+ *	Returns the fixed value of an integer.
+ */
+static inline fixed fixed_from_int( int i ) {
+	return (fixed) ( (uint32_t) i << FIXED_SHIFT );
+}
+
+/*
+ *	fixed_to_double:
+ *
+ *	Returns the exact double value of a fixed number.
+ */
+static inline double fixed_to_double( fixed a ) {
+	return a / (double) FIXED_ONE;
+}
+
+/*
+ *	fixed_mul:
+ *
+ *	Returns the product of two fixed numbers, rounded to the nearest
+ *	fixed value (halves round up).
+ */
+static inline fixed fixed_mul( fixed a, fixed b ) {
+	return (fixed) ( ( (int64_t) a * b + ( FIXED_ONE >> 1 ) ) >> FIXED_SHIFT );
+}
+
+/*
+ *	fixed_trunc:
+ *
+ *	Returns the whole part of a fixed number, rounding toward zero as a
+ *	cast from double to int does.
+ */
+static inline int fixed_trunc( fixed a ) {
+	return a >= 0 ? a >> FIXED_SHIFT : -( -a >> FIXED_SHIFT );
+}
+
+/*
+ *	fixed_round:
+ *
+ *	Returns the nearest integer to a fixed number, rounding halves away
+ *	from zero as round() does.
+ */
+static inline int fixed_round( fixed a ) {
+	fixed half = FIXED_ONE >> 1;
+	return a >= 0 ? ( a + half ) >> FIXED_SHIFT : -( ( -a + half ) >> FIXED_SHIFT );
+}
+
+/*
+ *	fixed_hypot:
+ *
+ *	Returns the length of the vector (dx, dy), rounded down. The squares
+ *	are summed in 64 bits, so the result cannot overflow for any arguments
+ *	whose length is less than 32768.
+ *
+ *	Input:
+ *		dx, dy: The components of the vector.
+ */
+fixed fixed_hypot( fixed dx, fixed dy );
+
+/*
+ *	fixed_sin_deg, fixed_cos_deg:
+ *
+ *	Return the sine and cosine of an angle measured in whole degrees,
+ *	looked up in a table. Any angle, positive or negative, may be used.
+ *
+ *	Input:
+ *		degrees: The angle.
+ */
+fixed fixed_sin_deg( int degrees );
+fixed fixed_cos_deg( int degrees );
+
+#endif
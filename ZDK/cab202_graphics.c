@@ -14,7 +14,8 @@
 #include <stdlib.h>
 #include "cab202_graphics.h"
 #include "cab202_timers.h"
-#include "curses.h"
+#include "cab202_backend.h"
+#include "cab202_capture.h"
 
 #define ABS(x)	(((x) >= 0) ? (x) : -(x))
 #define SIGN(x)	(((x) > 0) - ((x) < 0))
@@ -35,35 +36,240 @@ typedef struct Screen {
  */
 Screen * override_screen = NULL;
 
-/**
- *	Set up the terminal display for curses-based graphics.
+/*
+ *	Cell buffers used to keep terminal traffic to a minimum. All drawing
+ *	goes to the back buffer. The front buffer holds what has already been
+ *	sent to the terminal, so show_screen() only transmits the difference.
  */
-void setup_screen( void ) {
-	// Enter curses mode.
-	initscr();
+static Screen back_screen = { 0, 0, NULL };
+static Screen front_screen = { 0, 0, NULL };
+
+/*
+ *	Rectangles reported as changed since the last call to show_screen().
+ *	If the list overflows, or if full_compare is set, every cell is compared.
+ */
+#define MAX_DIRTY_RECTS 128
+static screen_rect dirty_rects[MAX_DIRTY_RECTS];
+static int dirty_count = 0;
+static bool full_compare = true;
+
+/*
+ *	Per-row extents of the dirty rectangles, used by show_screen to push
+ *	changes in row order. Each holds one entry per row of the screen.
+ */
+static int * row_left = NULL;
+static int * row_right = NULL;
+
+/*
+ *	Estimated bytes sent to the terminal by the most recent frame, and in total.
+ */
+static long frame_bytes = 0;
+static long total_bytes = 0;
+
+/*
+ *	Longest run of unchanged cells which show_screen resends rather than
+ *	skips over. Moving the cursor past a gap costs at least three bytes.
+ */
+#define MAX_MERGED_GAP 3
+
+/*
+ *	Region to which clear_screen and all drawing operations are restricted,
+ *	if clipping is enabled. See set_clip_rect.
+ */
+static screen_rect clip_rect = { 0, 0, 0, 0 };
+static bool clipping = false;
+
+static void fill_span( Screen * screen, int x1, int x2, int y, char value );
+
+/*
+ *	Releases the memory used by a cell buffer.
+ */
+static void free_buffer( Screen * screen ) {
+	free( screen->buffer );
+	screen->buffer = NULL;
+	screen->width = 0;
+	screen->height = 0;
+}
+
+/*
+ *	Makes sure that the back and front buffers match the dimensions of the
+ *	terminal. If they do not, both are reallocated and blanked, and the
+ *	terminal is cleared so that it matches the (blank) front buffer. If the
+ *	memory cannot be allocated, the previous buffers (if any) are kept and
+ *	the next call tries again.
+ */
+static void fit_buffers( void ) {
+	int w = backend_width();
+	int h = backend_height();
+
+	if ( w < 0 ) w = 0;
+	if ( h < 0 ) h = 0;
+
+	if ( back_screen.buffer != NULL && back_screen.width == w && back_screen.height == h ) return;
+
+	char * back = malloc( w * h + 1 );
+	char * front = malloc( w * h + 1 );
+	int * rows = malloc( 2 * ( h + 1 ) * sizeof( int ) );
+
+	if ( back == NULL || front == NULL || rows == NULL ) {
+		free( back );
+		free( front );
+		free( rows );
+		return;
+	}
+
+	free_buffer( &back_screen );
+	free_buffer( &front_screen );
+
+	back_screen.width = front_screen.width = w;
+	back_screen.height = front_screen.height = h;
+	back_screen.buffer = back;
+	front_screen.buffer = front;
+	memset( back_screen.buffer, ' ', w * h );
+	memset( front_screen.buffer, ' ', w * h );
+
+	free( row_left );
+	row_left = rows;
+	row_right = row_left + h + 1;
+
+	backend_clear();
+	full_compare = true;
+}
+
+/*
+ *	Returns the estimated number of bytes needed to position the cursor
+ *	at (x,y), based on the ANSI sequence ESC [ row ; col H.
+ */
+static int cursor_move_cost( int x, int y ) {
+	int cost = 4;
+
+	for ( int v = y + 1; v > 0; v /= 10 ) cost++;
+	for ( int v = x + 1; v > 0; v /= 10 ) cost++;
+
+	return cost;
+}
+
+/*
+ *	Sends the cells which differ between back and front buffers within
+ *	a rectangle to the display, and updates the front buffer to match.
+ */
+static void push_rect( int left, int top, int width, int height ) {
+	int w = back_screen.width;
+	char * back = back_screen.buffer;
+	char * front = front_screen.buffer;
+
+	for ( int y = top; y < top + height; y++ ) {
+		int row = y * w;
+		int x = left;
+
+		while ( x < left + width ) {
+			// Skip unchanged cells.
+			while ( x < left + width && back[row + x] == front[row + x] ) x++;
+
+			if ( x >= left + width ) break;
+
+			// Measure the run of changed cells. Short gaps of unchanged cells are
+			// included, since resending them is no dearer than skipping them.
+			int start = x;
+
+			for ( ;; ) {
+				while ( x < left + width && back[row + x] != front[row + x] ) x++;
+
+				int gap = x;
+				while ( gap < left + width && gap - x < MAX_MERGED_GAP && back[row + gap] == front[row + gap] ) gap++;
+
+				if ( gap >= left + width || gap - x >= MAX_MERGED_GAP ) break;
 
-	// Do not echo keypresses.
-	noecho();
+				x = gap;
+			}
+
+			int len = x - start;
+			backend_put( start, y, back + row + start, len );
+			memcpy( front + row + start, back + row + start, len );
+			frame_bytes += cursor_move_cost( start, y ) + len;
+		}
+	}
+}
+
+/*
+ *	Transmits all changes in the back buffer to the display.
+ */
+static void push_changes( void ) {
+	fit_buffers();
+	frame_bytes = 0;
+
+	if ( full_compare || dirty_count == 0 ) {
+		push_rect( 0, 0, back_screen.width, back_screen.height );
+	}
+	else {
+		// Merge the rectangles into one span per row, then push the rows top
+		// to bottom so the cursor only ever moves a short way between runs.
+		int h = back_screen.height;
+
+		if ( row_left == NULL ) {
+			push_rect( 0, 0, back_screen.width, h );
+		}
+		else {
+			for ( int y = 0; y < h; y++ ) {
+				row_left[y] = back_screen.width;
+				row_right[y] = 0;
+			}
+
+			for ( int i = 0; i < dirty_count; i++ ) {
+				screen_rect * r = &dirty_rects[i];
+
+				for ( int y = r->y; y < r->y + r->height; y++ ) {
+					if ( r->x < row_left[y] ) row_left[y] = r->x;
+					if ( r->x + r->width > row_right[y] ) row_right[y] = r->x + r->width;
+				}
+			}
 
-	// Turn off the cursor.
-	curs_set( 0 );
+			for ( int y = 0; y < h; y++ ) {
+				if ( row_left[y] < row_right[y] ) {
+					push_rect( row_left[y], y, row_right[y] - row_left[y], 1 );
+				}
+			}
+		}
+	}
+
+	total_bytes += frame_bytes;
+	dirty_count = 0;
+	full_compare = false;
+}
+
+/**
+ *	Set up the display for character-based graphics.
+ */
+void setup_screen( void ) {
+	// Prepare the display, which leaves it blank.
+	backend_setup();
 
-	// Cause getch to return ERR if no key pressed within 0 milliseconds.
-	timeout( 0 );
+	// Start a capture if one has been requested through the environment.
+	char * capture_name = getenv( "ZDK_CAPTURE" );
 
-	// Enable the keypad.
-	keypad( stdscr, TRUE );
+	if ( capture_name != NULL && !capture_active() ) {
+		start_capture( capture_name, 0 );
+	}
 
-	// Erase any previous content that may be lingering in this screen.
-	clear();
+	// Start again with blank buffers that match the cleared terminal.
+	free_buffer( &back_screen );
+	free_buffer( &front_screen );
+	fit_buffers();
 }
 
 /**
 *	Restore the terminal to its normal operational state.
 */
 void cleanup_screen( void ) {
-	// cleanup curses.
-	endwin();
+	// cleanup the display and any capture in progress.
+	backend_cleanup();
+	stop_capture();
+
+	// cleanup the cell buffers.
+	free_buffer( &back_screen );
+	free_buffer( &front_screen );
+	free( row_left );
+	row_left = row_right = NULL;
 
 	// cleanup the extended override screen, if it exists.
 	if ( override_screen != NULL ) {
@@ -77,15 +283,27 @@ void cleanup_screen( void ) {
 *	Clear the terminal window.
 */
 void clear_screen( void ) {
-	// Clear the curses screen.
-	clear();
+	// Clear the back buffer. The terminal itself is only updated by show_screen,
+	// and then only where the new frame differs from the old one.
+	fit_buffers();
 
-	// Erase the contents of the current window.
-	if ( override_screen != NULL ) {
-		int w = override_screen->width;
-		int h = override_screen->height;
-		char * scr = override_screen->buffer;
-		memset( scr, ' ', w * h );
+	if ( !clipping ) {
+		if ( back_screen.buffer != NULL ) {
+			memset( back_screen.buffer, ' ', back_screen.width * back_screen.height );
+		}
+
+		// Erase the contents of the current window.
+		if ( override_screen != NULL ) {
+			memset( override_screen->buffer, ' ', override_screen->width * override_screen->height );
+		}
+
+		return;
+	}
+
+	// Erase only the clip rectangle.
+	for ( int y = clip_rect.y; y < clip_rect.y + clip_rect.height; y++ ) {
+		fill_span( &back_screen, clip_rect.x, clip_rect.x + clip_rect.width - 1, y, ' ' );
+		fill_span( override_screen, clip_rect.x, clip_rect.x + clip_rect.width - 1, y, ' ' );
 	}
 }
 
@@ -98,66 +316,297 @@ void show_screen( void ) {
 		save_screen();
 	}
 
-	// Force an update of the curses display.
-	refresh();
+	// Send changed cells to the display, then force an update of the display.
+	push_changes();
+	backend_refresh();
+
+	// Append the frame to the binary capture, if one is running.
+	if ( capture_active() ) {
+		capture_frame( back_screen.buffer, back_screen.width, back_screen.height );
+	}
+}
+
+/**
+*	Reports that a rectangle may have changed since the last call to show_screen.
+*/
+void mark_dirty( int x, int y, int width, int height ) {
+	int w = back_screen.width;
+	int h = back_screen.height;
+
+	// Clip to the screen.
+	if ( x < 0 ) { width += x; x = 0; }
+	if ( y < 0 ) { height += y; y = 0; }
+	if ( x + width > w ) width = w - x;
+	if ( y + height > h ) height = h - y;
+
+	if ( width <= 0 || height <= 0 || full_compare ) return;
+
+	if ( dirty_count >= MAX_DIRTY_RECTS ) {
+		full_compare = true;
+		return;
+	}
+
+	screen_rect * r = &dirty_rects[dirty_count++];
+	r->x = x;
+	r->y = y;
+	r->width = width;
+	r->height = height;
+}
+
+/**
+*	Reports that an object previously drawn inside *bounds is now drawn
+*	inside (x,y,width,height).
+*/
+void mark_dirty_move( screen_rect * bounds, int x, int y, int width, int height ) {
+	if ( width <= 0 || height <= 0 ) {
+		// Object has disappeared; only its old location needs attention.
+		mark_dirty( bounds->x, bounds->y, bounds->width, bounds->height );
+	}
+	else if ( bounds->width <= 0 || bounds->height <= 0 ) {
+		// Object has just appeared.
+		mark_dirty( x, y, width, height );
+	}
+	else {
+		// Report the union of the old and new bounds as a single rectangle.
+		int left = bounds->x < x ? bounds->x : x;
+		int top = bounds->y < y ? bounds->y : y;
+		int right = bounds->x + bounds->width > x + width ? bounds->x + bounds->width : x + width;
+		int bottom = bounds->y + bounds->height > y + height ? bounds->y + bounds->height : y + height;
+		mark_dirty( left, top, right - left, bottom - top );
+	}
+
+	bounds->x = x;
+	bounds->y = y;
+	bounds->width = width > 0 ? width : 0;
+	bounds->height = height > 0 ? height : 0;
+}
+
+/**
+*	Forces the next call to show_screen to compare every cell.
+*/
+void invalidate_screen( void ) {
+	full_compare = true;
+	dirty_count = 0;
+}
+
+/**
+*	Returns the estimated number of bytes sent by the most recent show_screen.
+*/
+long screen_bytes_per_frame( void ) {
+	return frame_bytes;
+}
+
+/**
+*	Returns the estimated number of bytes sent since the screen was set up.
+*/
+long screen_bytes_total( void ) {
+	return total_bytes;
+}
+
+/*
+ *	Computes the region of a screen buffer that may be drawn on: the whole
+ *	buffer, intersected with the clip rectangle if clipping is enabled.
+ *	The right and bottom limits are exclusive.
+ */
+static void clip_limits( Screen * screen, int * left, int * top, int * right, int * bottom ) {
+	*left = 0;
+	*top = 0;
+	*right = screen->width;
+	*bottom = screen->height;
+
+	if ( clipping ) {
+		if ( clip_rect.x > *left ) *left = clip_rect.x;
+		if ( clip_rect.y > *top ) *top = clip_rect.y;
+		if ( clip_rect.x + clip_rect.width < *right ) *right = clip_rect.x + clip_rect.width;
+		if ( clip_rect.y + clip_rect.height < *bottom ) *bottom = clip_rect.y + clip_rect.height;
+	}
+}
+
+/**
+*	Restricts clear_screen and drawing to the rectangle (x,y,width,height).
+*/
+void set_clip_rect( int x, int y, int width, int height ) {
+	clip_rect.x = x;
+	clip_rect.y = y;
+	clip_rect.width = width;
+	clip_rect.height = height;
+	clipping = true;
+}
+
+/**
+*	Allows clear_screen and drawing to reach the whole screen again.
+*/
+void reset_clip_rect( void ) {
+	clipping = false;
+}
+
+/*
+ *	Fills the horizontal span x1..x2 (inclusive, x1 <= x2) on row y of a
+ *	screen buffer, after clipping it to the buffer.
+ */
+static void fill_span( Screen * screen, int x1, int x2, int y, char value ) {
+	if ( screen == NULL ) return;
+
+	int left, top, right, bottom;
+	clip_limits( screen, &left, &top, &right, &bottom );
+
+	if ( y < top || y >= bottom ) return;
+	if ( x1 < left ) x1 = left;
+	if ( x2 >= right ) x2 = right - 1;
+	if ( x1 > x2 ) return;
+
+	memset( screen->buffer + y * screen->width + x1, value, x2 - x1 + 1 );
+}
+
+/*
+ *	Fills the vertical span y1..y2 (inclusive, y1 <= y2) in column x of a
+ *	screen buffer, after clipping it to the buffer.
+ */
+static void fill_column( Screen * screen, int x, int y1, int y2, char value ) {
+	if ( screen == NULL ) return;
+
+	int left, top, right, bottom;
+	clip_limits( screen, &left, &top, &right, &bottom );
+
+	if ( x < left || x >= right ) return;
+	if ( y1 < top ) y1 = top;
+	if ( y2 >= bottom ) y2 = bottom - 1;
+
+	int w = screen->width;
+	char * cell = screen->buffer + y1 * w + x;
+
+	for ( int y = y1; y <= y2; y++, cell += w ) {
+		*cell = value;
+	}
+}
+
+/*
+ *	Copies length characters to row y of a screen buffer, starting at
+ *	column x, after clipping the run to the buffer.
+ */
+static void copy_span( Screen * screen, int x, int y, const char * text, int length ) {
+	if ( screen == NULL ) return;
+
+	int left, top, right, bottom;
+	clip_limits( screen, &left, &top, &right, &bottom );
+
+	if ( y < top || y >= bottom ) return;
+
+	if ( x < left ) {
+		text += left - x;
+		length -= left - x;
+		x = left;
+	}
+
+	if ( x + length > right ) length = right - x;
+	if ( length <= 0 ) return;
+
+	memcpy( screen->buffer + y * screen->width + x, text, length );
+}
+
+/*
+ *	Draws a diagonal line into a screen buffer using integer Bresenham.
+ *	Lines lying entirely outside the buffer are rejected without being traced;
+ *	otherwise each point is clipped individually.
+ */
+static void trace_line( Screen * screen, int x1, int y1, int x2, int y2, char value ) {
+	if ( screen == NULL ) return;
+
+	int w = screen->width;
+	int left, top, right, bottom;
+	clip_limits( screen, &left, &top, &right, &bottom );
+
+	if ( ( x1 < left && x2 < left ) || ( x1 >= right && x2 >= right )
+		|| ( y1 < top && y2 < top ) || ( y1 >= bottom && y2 >= bottom ) ) return;
+
+	int dx = ABS( x2 - x1 );
+	int dy = -ABS( y2 - y1 );
+	int sx = SIGN( x2 - x1 );
+	int sy = SIGN( y2 - y1 );
+	int err = dx + dy;
+
+	for ( ;; ) {
+		if ( x1 >= left && x1 < right && y1 >= top && y1 < bottom ) {
+			screen->buffer[x1 + y1 * w] = value;
+		}
+
+		if ( x1 == x2 && y1 == y2 ) break;
+
+		int e2 = 2 * err;
+
+		if ( e2 >= dy ) {
+			err += dy;
+			x1 += sx;
+		}
+
+		if ( e2 <= dx ) {
+			err += dx;
+			y1 += sy;
+		}
+	}
 }
 
 /**
 *	Draws the specified character at the prescibed location (x,y) on the window.
 */
 void draw_char( int x, int y, char value ) {
-	// Always attempt to display the character, regardless of the size of the overridden screen.
-	mvaddch( y, x, value );
+	// Update the back buffer. The character reaches the terminal at the next show_screen.
+	// The overridden screen is updated as well.
+	copy_span( &back_screen, x, y, &value, 1 );
+	copy_span( override_screen, x, y, &value, 1 );
+}
 
-	// Update the overridden screen as well.
-	if ( override_screen != NULL ) {
-		int w = override_screen->width;
-		int h = override_screen->height;
+/**
+*	Draws a horizontal line from (x1,y) to (x2,y) using the specified character.
+*/
+void draw_hline( int x1, int x2, int y, char value ) {
+	if ( x1 > x2 ) {
+		int t = x1;
+		x1 = x2;
+		x2 = t;
+	}
 
-		if ( x >= 0 && x < w && y >= 0 && y < h ) {
-			char * scr = override_screen->buffer;
-			scr[x + y * w] = value;
-		}
+	fill_span( &back_screen, x1, x2, y, value );
+	fill_span( override_screen, x1, x2, y, value );
+}
+
+/**
+*	Draws a vertical line from (x,y1) to (x,y2) using the specified character.
+*/
+void draw_vline( int x, int y1, int y2, char value ) {
+	if ( y1 > y2 ) {
+		int t = y1;
+		y1 = y2;
+		y2 = t;
 	}
+
+	fill_column( &back_screen, x, y1, y2, value );
+	fill_column( override_screen, x, y1, y2, value );
 }
 
 void draw_line( int x1, int y1, int x2, int y2, char value ) {
-	if ( x1 == x2 ) {
-		// Draw vertical line
-		for ( int i = y1; ( y2 > y1 ) ? i <= y2 : i >= y2; ( y2 > y1 ) ? i++ : i-- ) {
-			draw_char( x1, i, value );
-		}
+	if ( y1 == y2 ) {
+		draw_hline( x1, x2, y1, value );
 	}
-	else if ( y1 == y2 ) {
-		// Draw horizontal line
-		for ( int i = x1; ( x2 > x1 ) ? i <= x2 : i >= x2; ( x2 > x1 ) ? i++ : i-- ) {
-			draw_char( i, y1, value );
-		}
+	else if ( x1 == x2 ) {
+		draw_vline( x1, y1, y2, value );
 	}
 	else {
-		// Get Bresenhaming...
-		float dx = x2 - x1;
-		float dy = y2 - y1;
-		float err = 0.0;
-		float derr = ABS( dy / dx );
-
-		for ( int x = x1, y = y1; ( dx > 0 ) ? x <= x2 : x >= x2; ( dx > 0 ) ? x++ : x-- ) {
-			draw_char( x, y, value );
-			err += derr;
-			while ( err >= 0.5 && ( ( dy > 0 ) ? y <= y2 : y >= y2 ) ) {
-				draw_char( x, y, value );
-				y += ( dy > 0 ) - ( dy < 0 );
-
-				err -= 1.0;
-			}
-		}
+		trace_line( &back_screen, x1, y1, x2, y2, value );
+		trace_line( override_screen, x1, y1, x2, y2, value );
 	}
 }
 
+/**
+*	Draws the first length characters of text at the specified location.
+*/
+void draw_chars( int x, int y, const char * text, int length ) {
+	copy_span( &back_screen, x, y, text, length );
+	copy_span( override_screen, x, y, text, length );
+}
+
 void draw_string( int x, int y, char * text ) {
-	for ( int i = 0; text[i]; i++ ) {
-		draw_char( x + i, y, text[i] );
-	}
+	draw_chars( x, y, text, strlen( text ) );
 }
 
 void draw_int( int x, int y, int value ) {
@@ -173,20 +622,42 @@ void draw_double( int x, int y, double value ) {
 }
 
 int get_char() {
-	int currentChar = getch();
+	int currentChar = backend_read_char( false );
 
 	// Save the character to the transcript, if screen save is enabled. 
 	if ( auto_save_screen ) {
 		save_char( currentChar );
 	}
 
+	// Add real key presses to the binary capture, if one is running.
+	if ( currentChar >= 0 && capture_active() ) {
+		capture_key( currentChar );
+	}
+
 	return currentChar;
 }
 
+bool wait_input( timer_ns deadline ) {
+	return backend_wait_input( deadline );
+}
+
 int wait_char() {
-	timeout( -1 );
-	int result = getch();
-	timeout( 0 );
+	// Make sure anything drawn since the last frame is visible before blocking:
+	// the ANSI backend only writes the frame when it is refreshed.
+	invalidate_screen();
+	push_changes();
+	backend_refresh();
+
+	if ( capture_active() ) {
+		capture_frame( back_screen.buffer, back_screen.width, back_screen.height );
+	}
+
+	int result = backend_read_char( true );
+
+	if ( result >= 0 && capture_active() ) {
+		capture_key( result );
+	}
+
 	return result;
 }
 
@@ -196,22 +667,27 @@ void get_screen_size_( int * width, int * height ) {
 }
 
 int screen_width( void ) {
-	return override_screen == NULL ? getmaxx( stdscr ) : override_screen->width;
+	return override_screen == NULL ? backend_width() : override_screen->width;
 }
 
 int screen_height( void ) {
-	return override_screen == NULL ? getmaxy( stdscr ) : override_screen->height;
+	return override_screen == NULL ? backend_height() : override_screen->height;
 }
 
 /**
  *	Gets the character at the designated location on the screen.
  *	This uses the override screen if it is non-NULL, or otherwise
- *	uses the current curses terminal.
+ *	uses the most recently drawn contents of the screen buffer.
  */
 
 char get_screen_char( int x, int y ) {
 	if ( override_screen == NULL ) {
-		return mvinch( y, x ) & 0xff;
+		if ( x >= 0 && x < back_screen.width && y >= 0 && y < back_screen.height ) {
+			return back_screen.buffer[x + y * back_screen.width];
+		}
+		else {
+			return 0;
+		}
 	}
 
 	int w = override_screen->width;
@@ -324,6 +800,9 @@ void draw_formatted( int x, int y, const char * format, ... ) {
 	va_list args;
 	va_start( args, format );
 	char buffer[1000];
-	vsprintf( buffer, format, args );
-	draw_string( x, y, buffer );
+	int length = vsnprintf( buffer, sizeof( buffer ), format, args );
+	va_end( args );
+
+	if ( length >= (int) sizeof( buffer ) ) length = sizeof( buffer ) - 1;
+	if ( length > 0 ) draw_chars( x, y, buffer, length );
 }
\ No newline at end of file
@@ -9,9 +9,17 @@
 
 #include <stdarg.h>
 #include <stdbool.h>
+#include "cab202_timers.h"
 
 /**
-*	Set up the terminal display for curses-based graphics.
+ *	A rectangular region of the screen, in character cells.
+ */
+typedef struct screen_rect {
+	int x, y, width, height;
+} screen_rect;
+
+/**
+*	Set up the display for character-based graphics.
 */
 void setup_screen( void );
 
@@ -22,14 +30,75 @@ void cleanup_screen( void );
 
 /**
 *	Clear the terminal window.
+*
+*	Drawing operations write to an off-screen buffer. Clearing the screen
+*	only blanks that buffer; nothing is sent to the terminal until the next
+*	call to show_screen.
+*
+*	If a clip rectangle has been set, only that rectangle is cleared.
 */
 void clear_screen( void );
 
+/**
+*	Restricts clear_screen and all drawing operations to the rectangle
+*	(x,y,width,height). Cells outside the rectangle keep their contents,
+*	so parts of the screen which rarely change (status lines, borders)
+*	need not be redrawn every frame.
+*/
+void set_clip_rect( int x, int y, int width, int height );
+
+/**
+*	Removes the clip rectangle set by set_clip_rect.
+*/
+void reset_clip_rect( void );
+
 /**
 *	Make the current contents of the window visible.
+*
+*	Only cells which differ from the previously displayed frame are sent to
+*	the terminal. If any rectangles have been reported via mark_dirty or
+*	mark_dirty_move since the last call, the comparison is restricted to
+*	those rectangles. Otherwise the whole screen is compared.
 */
 void show_screen( void );
 
+/**
+*	Reports that the rectangle (x,y,width,height) may have changed since
+*	the last call to show_screen.
+*/
+void mark_dirty( int x, int y, int width, int height );
+
+/**
+*	Reports that an object previously drawn inside *bounds is now drawn
+*	inside (x,y,width,height). Both rectangles are marked dirty, and *bounds
+*	is updated to the new location. A width or height of zero indicates that
+*	the object is no longer drawn.
+*
+*	A zero-initialised screen_rect denotes an object which has not yet
+*	been drawn.
+*/
+void mark_dirty_move( screen_rect * bounds, int x, int y, int width, int height );
+
+/**
+*	Forces the next call to show_screen to compare every cell on the screen,
+*	regardless of any rectangles reported via mark_dirty.
+*/
+void invalidate_screen( void );
+
+/**
+*	Returns an estimate of the number of bytes sent to the terminal by the
+*	most recent call to show_screen. The estimate counts each character
+*	transmitted plus one ANSI cursor-positioning sequence per run of
+*	changed cells.
+*/
+long screen_bytes_per_frame( void );
+
+/**
+*	Returns an estimate of the total number of bytes sent to the terminal
+*	by show_screen since the program started.
+*/
+long screen_bytes_total( void );
+
 /**
 *	Draws the specified character at the prescibed location (x,y) on the window.
 *
@@ -42,6 +111,12 @@ void draw_char( int x, int y, char value );
 */
 void draw_string( int x, int y, char * text );
 
+/**
+*	Draws the first length characters of text at the specified location.
+*	The run is clipped to the screen once and copied as a block.
+*/
+void draw_chars( int x, int y, const char * text, int length );
+
 /**
 *	Draws an integer value at the specified location.
 */
@@ -54,9 +129,25 @@ void draw_double( int x, int y, double value );
 
 /**
 *	Draws a line from (x1,y1) to (x2,y2) using the specified character.
+*
+*	Horizontal and vertical lines are handled by draw_hline and draw_vline.
+*	Other lines are traced with integer Bresenham.
 */
 void draw_line( int x1, int y1, int x2, int y2, char value );
 
+/**
+*	Draws a horizontal line from (x1,y) to (x2,y) inclusive, using the
+*	specified character. The span is clipped to the screen once and then
+*	filled as a block.
+*/
+void draw_hline( int x1, int x2, int y, char value );
+
+/**
+*	Draws a vertical line from (x,y1) to (x,y2) inclusive, using the
+*	specified character. The span is clipped to the screen once.
+*/
+void draw_vline( int x, int y1, int y2, char value );
+
 /**
  *	Gets the current dimensions of the screen.
  */
@@ -88,10 +179,25 @@ int wait_char( void );
  */
 int get_char( void );
 
+/**
+ *	Waits until a character is available from the standard input stream,
+ *	or the monotonic clock (see cab202_timers.h) reaches deadline,
+ *	whichever comes first. Unlike pausing and polling with get_char, no
+ *	time is spent awake while nothing is happening, and a key is seen as
+ *	soon as it arrives.
+ *
+ *	Input:
+ *		deadline: The time to give up, on the get_monotonic_ns clock.
+ *
+ *	Output:
+ *		Returns true if get_char will return a character.
+ */
+bool wait_input( timer_ns deadline );
+
 /**
  *	Gets the character at the designated location on the screen.
  *	This uses the override screen if it is non-NULL, or otherwise
- *	uses the current curses terminal.
+ *	uses the most recently drawn contents of the screen buffer.
  */
 
 char get_screen_char( int x, int y );
@@ -117,6 +223,9 @@ void save_char( int charCode );
 /*
  *	Automatically save a screen shot each time show_screen is called
  *	if this is non-zero.
+ *
+ *	Text screen shots are slow to write and large. For recording whole
+ *	sessions, use the binary capture in cab202_capture.h instead.
  */
 
 extern bool auto_save_screen;
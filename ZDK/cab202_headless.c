@@ -0,0 +1,270 @@
+/*
+ *	cab202_headless.c
+ *
+ *	Headless display backend for the ZDK graphics library. The display is a
+ *	block of memory and input comes from a queue, so programs run without a
+ *	terminal and without ncurses.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "cab202_backend.h"
+#include "cab202_headless.h"
+#include "cab202_timers.h"
+
+/*
+ *	Value returned when no input is available, matching curses.
+ */
+#define HEADLESS_ERR (-1)
+
+/*
+ *	Key codes for the named keys, matching curses.
+ */
+#define HEADLESS_KEY_DOWN 0402
+#define HEADLESS_KEY_UP 0403
+#define HEADLESS_KEY_LEFT 0404
+#define HEADLESS_KEY_RIGHT 0405
+
+/*
+ *	A queued key press.
+ */
+typedef struct Key_Event {
+	double time;
+	int key;
+} Key_Event;
+
+/*
+ *	The display framebuffer.
+ */
+static int fb_width = 0;
+static int fb_height = 0;
+static char * fb_cells = NULL;
+
+/*
+ *	The input queue. Events are consumed from key_first up to key_count.
+ */
+static Key_Event * key_queue = NULL;
+static int key_first = 0;
+static int key_count = 0;
+static int key_capacity = 0;
+static int end_key = 'q';
+static bool keys_loaded = false;
+
+/*
+ *	Reads the display size from ZDK_HEADLESS_SIZE, if it is set.
+ */
+static void read_size( void ) {
+	int w = HEADLESS_DEFAULT_WIDTH;
+	int h = HEADLESS_DEFAULT_HEIGHT;
+	char * size = getenv( "ZDK_HEADLESS_SIZE" );
+
+	if ( size != NULL && ( sscanf( size, "%dx%d", &w, &h ) != 2 || w <= 0 || h <= 0 ) ) {
+		w = HEADLESS_DEFAULT_WIDTH;
+		h = HEADLESS_DEFAULT_HEIGHT;
+	}
+
+	if ( fb_cells == NULL || w != fb_width || h != fb_height ) {
+		char * cells = malloc( w * h );
+
+		if ( cells == NULL ) {
+			// Keep the framebuffer there is; with none, the display has no cells.
+			fprintf( stderr, "zdk: unable to allocate a %dx%d framebuffer\n", w, h );
+
+			if ( fb_cells == NULL ) fb_width = fb_height = 0;
+			return;
+		}
+
+		free( fb_cells );
+		fb_width = w;
+		fb_height = h;
+		fb_cells = cells;
+	}
+}
+
+/*
+ *	Writes the framebuffer to the file named by ZDK_HEADLESS_DUMP, if it is set.
+ */
+static void dump_screen( void ) {
+	char * file_name = getenv( "ZDK_HEADLESS_DUMP" );
+
+	if ( file_name == NULL || fb_cells == NULL ) return;
+
+	FILE * f = fopen( file_name, "w" );
+
+	if ( f == NULL ) return;
+
+	for ( int y = 0; y < fb_height; y++ ) {
+		fwrite( fb_cells + y * fb_width, 1, fb_width, f );
+		fputc( '\n', f );
+	}
+
+	fclose( f );
+}
+
+void backend_setup( void ) {
+	read_size();
+	backend_clear();
+
+	// Queue the scripted input once only, even if the screen is set up again.
+	if ( !keys_loaded ) {
+		keys_loaded = true;
+		char * file_name = getenv( "ZDK_HEADLESS_INPUT" );
+
+		if ( file_name != NULL && !headless_load_keys( file_name ) ) {
+			fprintf( stderr, "zdk: unable to read key file %s\n", file_name );
+		}
+	}
+}
+
+void backend_cleanup( void ) {
+	dump_screen();
+}
+
+int backend_width( void ) {
+	return fb_width;
+}
+
+int backend_height( void ) {
+	return fb_height;
+}
+
+void backend_clear( void ) {
+	if ( fb_cells != NULL ) {
+		memset( fb_cells, ' ', fb_width * fb_height );
+	}
+}
+
+void backend_put( int x, int y, const char * text, int length ) {
+	if ( fb_cells != NULL && y >= 0 && y < fb_height && x >= 0 && x + length <= fb_width ) {
+		memcpy( fb_cells + y * fb_width + x, text, length );
+	}
+}
+
+void backend_refresh( void ) {
+	// Nothing to do; the framebuffer is always up to date.
+}
+
+int backend_read_char( bool wait ) {
+	if ( key_first >= key_count ) {
+		return end_key;
+	}
+
+	Key_Event * next = &key_queue[key_first];
+	double now = get_current_time();
+
+	if ( next->time > now ) {
+		if ( !wait ) {
+			return HEADLESS_ERR;
+		}
+
+		// Let simulated time pass until the key is pressed.
+		timer_pause( (long) ceil( ( next->time - now ) * MILLISECONDS ) );
+	}
+
+	key_first++;
+	return next->key;
+}
+
+bool backend_wait_input( timer_ns deadline ) {
+	if ( key_first >= key_count ) {
+		if ( end_key != HEADLESS_ERR ) return true;
+
+		timer_sleep_until( deadline );
+		return false;
+	}
+
+	// The first time at which get_current_time reaches the key's time.
+	double time = key_queue[key_first].time;
+	timer_ns due = (timer_ns) ceil( time * NANOSECONDS );
+
+	while ( (double) due / NANOSECONDS < time ) due++;
+
+	// Let simulated time pass until the key is pressed, or the deadline.
+	timer_sleep_until( due < deadline ? due : deadline );
+	return due <= deadline;
+}
+
+void headless_push_key( double time, int key ) {
+	if ( key_count >= key_capacity ) {
+		// Reclaim consumed entries before growing the queue.
+		if ( key_first > 0 ) {
+			memmove( key_queue, key_queue + key_first, ( key_count - key_first ) * sizeof( Key_Event ) );
+			key_count -= key_first;
+			key_first = 0;
+		}
+
+		if ( key_count >= key_capacity ) {
+			int capacity = key_capacity == 0 ? 64 : key_capacity * 2;
+			Key_Event * queue = realloc( key_queue, capacity * sizeof( Key_Event ) );
+
+			// Drop the key, rather than the queue, if it cannot grow.
+			if ( queue == NULL ) return;
+
+			key_queue = queue;
+			key_capacity = capacity;
+		}
+	}
+
+	key_queue[key_count].time = time;
+	key_queue[key_count].key = key;
+	key_count++;
+}
+
+/*
+ *	Converts a key name from a key file to a key code. Returns HEADLESS_ERR
+ *	if the name is not recognised.
+ */
+static int parse_key( const char * name ) {
+	if ( strcmp( name, "UP" ) == 0 ) return HEADLESS_KEY_UP;
+	if ( strcmp( name, "DOWN" ) == 0 ) return HEADLESS_KEY_DOWN;
+	if ( strcmp( name, "LEFT" ) == 0 ) return HEADLESS_KEY_LEFT;
+	if ( strcmp( name, "RIGHT" ) == 0 ) return HEADLESS_KEY_RIGHT;
+	if ( strcmp( name, "SPACE" ) == 0 ) return ' ';
+	if ( name[1] == 0 ) return name[0] & 0xff;
+
+	char * end;
+	long code = strtol( name, &end, 10 );
+	return *end == 0 && code >= 0 ? (int) code : HEADLESS_ERR;
+}
+
+bool headless_load_keys( const char * file_name ) {
+	FILE * f = fopen( file_name, "r" );
+
+	if ( f == NULL ) return false;
+
+	char line[256];
+	bool ok = true;
+
+	while ( fgets( line, sizeof( line ), f ) != NULL ) {
+		double time;
+		char name[64];
+
+		if ( line[0] == '#' ) continue;
+
+		int fields = sscanf( line, "%lf %63s", &time, name );
+
+		if ( fields <= 0 ) continue;
+
+		int key = fields == 2 ? parse_key( name ) : HEADLESS_ERR;
+
+		if ( key == HEADLESS_ERR ) {
+			ok = false;
+			continue;
+		}
+
+		headless_push_key( time, key );
+	}
+
+	fclose( f );
+	return ok;
+}
+
+void headless_set_end_key( int key ) {
+	end_key = key;
+}
+
+int headless_pending_keys( void ) {
+	return key_count - key_first;
+}
@@ -0,0 +1,76 @@
+/*
+ *	cab202_headless.h
+ *
+ *	Input and configuration for the headless build of the ZDK graphics
+ *	library, libzdk_headless.a. It implements the whole of cab202_graphics.h
+ *	without a terminal: the screen is an in-memory framebuffer, keys come
+ *	from a queue, and time is a simulated clock that only advances when the
+ *	program pauses. An unmodified program linked against it therefore runs
+ *	as fast as the processor allows, with no tty.
+ *
+ *	A program can be driven entirely from outside through these
+ *	environment variables:
+ *
+ *		ZDK_HEADLESS_SIZE	Screen size as WIDTHxHEIGHT. Default 70x55.
+ *		ZDK_HEADLESS_INPUT	Key file queued by the first call to setup_screen.
+ *		ZDK_HEADLESS_DUMP	File to which cleanup_screen writes the final screen.
+ */
+
+#ifndef __CAB202_HEADLESS_H__
+#define __CAB202_HEADLESS_H__
+
+#include <stdbool.h>
+
+/*
+ *	Default screen dimensions, matching the layout the game is designed for.
+ */
+#define HEADLESS_DEFAULT_WIDTH 70
+#define HEADLESS_DEFAULT_HEIGHT 55
+
+/*
+ *	headless_push_key:
+ *
+ *	Appends a key to the input queue. get_char will not return the key
+ *	before the simulated clock reaches the given time; wait_char advances
+ *	the clock to that time if necessary. Keys are delivered in the order
+ *	they were queued. The key is dropped if the queue cannot grow.
+ *
+ *	Input:
+ *		time: The simulated time, in seconds, at which the key is pressed.
+ *		key: The key code, as returned by get_char.
+ */
+void headless_push_key( double time, int key );
+
+/*
+ *	headless_load_keys:
+ *
+ *	Queues the keys listed in a text file. Each non-blank line holds a time
+ *	in seconds and a key, separated by white space. The key is one of the
+ *	names UP, DOWN, LEFT, RIGHT or SPACE, a single character, or a decimal
+ *	key code of two or more digits. Lines starting with '#' are ignored.
+ *
+ *	Input:
+ *		file_name: The file to read.
+ *
+ *	Output:
+ *		Returns true if and only if the file was read without error.
+ */
+bool headless_load_keys( const char * file_name );
+
+/*
+ *	headless_set_end_key:
+ *
+ *	Sets the key returned by get_char and wait_char once the queue is
+ *	empty. The default is 'q', so that a program which quits on 'q' stops
+ *	when its input runs out.
+ */
+void headless_set_end_key( int key );
+
+/*
+ *	headless_pending_keys:
+ *
+ *	Returns the number of keys still waiting in the input queue.
+ */
+int headless_pending_keys( void );
+
+#endif
@@ -0,0 +1,206 @@
+/*
+ *	cab202_sprite_pool.c
+ *
+ *	Sprites stored in bulk. See cab202_sprite_pool.h.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cab202_sprite_pool.h"
+
+/**
+ *	Allocates the storage for a pool of sprites.
+ */
+bool sprite_pool_init( sprite_pool * pool, int capacity ) {
+	assert( pool != NULL );
+	assert( capacity > 0 );
+
+	memset( pool, 0, sizeof( sprite_pool ) );
+
+	pool->x = calloc( capacity, sizeof( double ) );
+	pool->y = calloc( capacity, sizeof( double ) );
+	pool->dx = calloc( capacity, sizeof( double ) );
+	pool->dy = calloc( capacity, sizeof( double ) );
+	pool->is_visible = calloc( capacity, sizeof( bool ) );
+	pool->in_use = calloc( capacity, sizeof( bool ) );
+	pool->images = calloc( capacity, sizeof( sprite_t ) );
+	pool->free_slots = calloc( capacity, sizeof( int ) );
+	pool->capacity = capacity;
+
+	if ( pool->x == NULL || pool->y == NULL || pool->dx == NULL || pool->dy == NULL
+		|| pool->is_visible == NULL || pool->in_use == NULL
+		|| pool->images == NULL || pool->free_slots == NULL ) {
+		sprite_pool_release( pool );
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ *	Frees the storage of a pool.
+ */
+void sprite_pool_release( sprite_pool * pool ) {
+	assert( pool != NULL );
+
+	if ( pool->images != NULL ) {
+		for ( int i = 0; i < pool->capacity; i++ ) {
+			free( pool->images[i].spans );
+			free( pool->images[i].row_spans );
+		}
+	}
+
+	free( pool->x );
+	free( pool->y );
+	free( pool->dx );
+	free( pool->dy );
+	free( pool->is_visible );
+	free( pool->in_use );
+	free( pool->images );
+	free( pool->free_slots );
+	memset( pool, 0, sizeof( sprite_pool ) );
+}
+
+/**
+ *	Removes every sprite from a pool. The opaque runs built for each slot
+ *	are kept, so slots reused with the same bitmap need not rebuild them.
+ */
+void sprite_pool_clear( sprite_pool * pool ) {
+	assert( pool != NULL );
+
+	memset( pool->dx, 0, pool->used * sizeof( double ) );
+	memset( pool->dy, 0, pool->used * sizeof( double ) );
+	memset( pool->is_visible, 0, pool->used * sizeof( bool ) );
+	memset( pool->in_use, 0, pool->used * sizeof( bool ) );
+	pool->used = 0;
+	pool->live = 0;
+	pool->free_count = 0;
+}
+
+/**
+ *	Places a sprite in a free slot of a pool. Free slots below the high
+ *	water mark are reused first, most recently freed first.
+ */
+pool_sprite_id sprite_pool_create( sprite_pool * pool, double x, double y, int width, int height, char * bitmap ) {
+	assert( pool != NULL );
+	assert( width > 0 );
+	assert( height > 0 );
+	assert( bitmap != NULL );
+
+	pool_sprite_id id;
+
+	if ( pool->free_count > 0 ) {
+		id = pool->free_slots[--pool->free_count];
+	}
+	else if ( pool->used < pool->capacity ) {
+		id = pool->used++;
+	}
+	else {
+		return NO_POOL_SPRITE;
+	}
+
+	pool->x[id] = x;
+	pool->y[id] = y;
+	pool->dx[id] = 0;
+	pool->dy[id] = 0;
+	pool->is_visible[id] = true;
+	pool->in_use[id] = true;
+	pool->live++;
+
+	// Keep the runs built for this slot if it shows the same image again.
+	sprite_t * image = &pool->images[id];
+
+	if ( image->width != width || image->height != height ) {
+		image->span_bitmap = NULL;
+	}
+
+	image->width = width;
+	image->height = height;
+	image->bitmap = bitmap;
+
+	return id;
+}
+
+/**
+ *	Removes a sprite from a pool. The slot is left stationary and
+ *	invisible, so batch operations may visit it harmlessly.
+ */
+void sprite_pool_destroy( sprite_pool * pool, pool_sprite_id id ) {
+	assert( pool != NULL );
+	assert( id >= 0 && id < pool->used );
+
+	if ( !pool->in_use[id] ) return;
+
+	pool->dx[id] = 0;
+	pool->dy[id] = 0;
+	pool->is_visible[id] = false;
+	pool->in_use[id] = false;
+	pool->free_slots[pool->free_count++] = id;
+	pool->live--;
+}
+
+/**
+ *	Changes the size and bitmap of a pooled sprite. The opaque runs are
+ *	rebuilt on the next draw.
+ */
+void sprite_pool_set_image( sprite_pool * pool, pool_sprite_id id, int width, int height, char * bitmap ) {
+	assert( pool != NULL );
+	assert( id >= 0 && id < pool->used );
+
+	sprite_t * image = &pool->images[id];
+	image->width = width;
+	image->height = height;
+	image->bitmap = bitmap;
+	image->span_bitmap = NULL;
+}
+
+/*
+ *	Adds step[i] to value[i] for i = 0 .. n - 1. The arrays never overlap,
+ *	which lets the compiler vectorise the loop without runtime checks.
+ */
+static void add_steps( double * restrict value, const double * restrict step, int n ) {
+	for ( int i = 0; i < n; i++ ) {
+		value[i] += step[i];
+	}
+}
+
+/**
+ *	Moves every sprite in a pool one step. Free slots have zero step, so
+ *	the loops need no test and compile to straight vector code.
+ */
+void sprite_step_all( sprite_pool * pool ) {
+	assert( pool != NULL );
+
+	add_steps( pool->x, pool->dx, pool->used );
+	add_steps( pool->y, pool->dy, pool->used );
+}
+
+/**
+ *	Draws a pooled sprite.
+ */
+void sprite_pool_draw( sprite_pool * pool, pool_sprite_id id ) {
+	assert( pool != NULL );
+	assert( id >= 0 && id < pool->used );
+
+	if ( !pool->is_visible[id] ) return;
+
+	sprite_t * image = &pool->images[id];
+	image->x = pool->x[id];
+	image->y = pool->y[id];
+	image->is_visible = true;
+	sprite_draw( image );
+}
+
+/**
+ *	Draws every visible sprite in a pool.
+ */
+void sprite_draw_all( sprite_pool * pool ) {
+	assert( pool != NULL );
+
+	for ( int i = 0; i < pool->used; i++ ) {
+		if ( pool->is_visible[i] ) {
+			sprite_pool_draw( pool, i );
+		}
+	}
+}
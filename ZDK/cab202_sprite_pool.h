@@ -0,0 +1,187 @@
+/*
+ *	cab202_sprite_pool.h
+ *
+ *	Sprites stored in bulk, for programs which move many of them at once.
+ *
+ *	A sprite_pool holds a fixed number of sprite slots. The values that
+ *	change every step (position, direction, visibility) are kept in
+ *	parallel arrays, one element per slot, so that sprite_step_all is a
+ *	single pass over contiguous memory which the compiler can vectorise.
+ *	Image data (size, bitmap and the opaque runs used for drawing) is kept
+ *	apart, since it is only needed when a sprite is drawn.
+ *
+ *	Storage is allocated by sprite_pool_init. Creating and destroying
+ *	pooled sprites afterwards only reuses slots, with no heap traffic other
+ *	than building the opaque runs of an image the first time a slot draws it.
+ *	Pooled sprites are identified by slot number rather than by address.
+ */
+
+#ifndef __CAB202_SPRITE_POOL_H__
+#define __CAB202_SPRITE_POOL_H__
+
+#include <stdbool.h>
+#include "cab202_sprites.h"
+
+/*
+ *	Identifies a sprite within a pool: the number of its slot.
+ */
+typedef int pool_sprite_id;
+
+/*
+ *	Value returned by sprite_pool_create when the pool is full.
+ */
+#define NO_POOL_SPRITE (-1)
+
+/*
+ *	A pool of sprites.
+ *
+ *	Members:
+ *		capacity:	The number of slots.
+ *
+ *		used:		Slots 0 .. used - 1 have been handed out at some time.
+ *					Batch operations visit only these.
+ *
+ *		live:		The number of sprites currently in the pool.
+ *
+ *		x, y, dx, dy, is_visible: Location, step and visibility of each
+ *					slot, with the same meaning as the members of sprite_t.
+ *					Free slots have dx and dy zero and are invisible.
+ *
+ *		in_use:		True for each slot that holds a sprite.
+ *
+ *		images:		Width, height, bitmap and opaque runs of each slot.
+ *					Only the image members of these sprites are meaningful.
+ *
+ *		free_slots:	Stack of free slots below used, free_count deep.
+ */
+typedef struct sprite_pool {
+	int capacity;
+	int used;
+	int live;
+
+	double * x;
+	double * y;
+	double * dx;
+	double * dy;
+	bool * is_visible;
+	bool * in_use;
+
+	sprite_t * images;
+
+	int * free_slots;
+	int free_count;
+} sprite_pool;
+
+/*
+ *	sprite_pool_init:
+ *
+ *	Allocates the storage for a pool of sprites. The pool is initially empty.
+ *
+ *	Input:
+ *		pool: The pool to initialise.
+ *		capacity: The maximum number of sprites the pool can hold.
+ *
+ *	Output:
+ *		Returns false if memory could not be allocated.
+ */
+bool sprite_pool_init( sprite_pool * pool, int capacity );
+
+/*
+ *	sprite_pool_release:
+ *
+ *	Frees the storage of a pool. The pool may be initialised again afterwards.
+ *
+ *	Input:
+ *		pool: The pool to release.
+ */
+void sprite_pool_release( sprite_pool * pool );
+
+/*
+ *	sprite_pool_clear:
+ *
+ *	Removes every sprite from a pool, keeping its storage.
+ *
+ *	Input:
+ *		pool: The pool to clear.
+ */
+void sprite_pool_clear( sprite_pool * pool );
+
+/*
+ *	sprite_pool_create:
+ *
+ *	Places a sprite in a free slot of a pool. The sprite is visible and
+ *	stationary, as if made by sprite_create.
+ *
+ *	Input:
+ *		pool: The pool.
+ *		x, y: The initial location of the sprite.
+ *		width, height: The dimensions of the sprite.
+ *		bitmap: The characters to show. The pool keeps a reference to the
+ *			bitmap, not a copy. If the slot last showed the same bitmap at
+ *			the same size, the opaque runs built for it are reused, so
+ *			use sprite_pool_set_image after changing a bitmap in place.
+ *
+ *	Output:
+ *		Returns the slot of the new sprite, or NO_POOL_SPRITE if the pool is full.
+ */
+pool_sprite_id sprite_pool_create( sprite_pool * pool, double x, double y, int width, int height, char * bitmap );
+
+/*
+ *	sprite_pool_destroy:
+ *
+ *	Removes a sprite from a pool. Its slot will be reused by a later call
+ *	to sprite_pool_create.
+ *
+ *	Input:
+ *		pool: The pool.
+ *		id: The slot of the sprite.
+ */
+void sprite_pool_destroy( sprite_pool * pool, pool_sprite_id id );
+
+/*
+ *	sprite_pool_set_image:
+ *
+ *	Changes the size and bitmap of a pooled sprite. The opaque runs used
+ *	for drawing are always rebuilt, even if the bitmap is the same array.
+ *
+ *	Input:
+ *		pool: The pool.
+ *		id: The slot of the sprite.
+ *		width, height: The new dimensions of the sprite.
+ *		bitmap: The new characters to show.
+ */
+void sprite_pool_set_image( sprite_pool * pool, pool_sprite_id id, int width, int height, char * bitmap );
+
+/*
+ *	sprite_step_all:
+ *
+ *	Moves every sprite in a pool one step, adding dx to x and dy to y, as
+ *	sprite_step does for a single sprite.
+ *
+ *	Input:
+ *		pool: The pool.
+ */
+void sprite_step_all( sprite_pool * pool );
+
+/*
+ *	sprite_pool_draw:
+ *
+ *	Draws a pooled sprite, as sprite_draw does.
+ *
+ *	Input:
+ *		pool: The pool.
+ *		id: The slot of the sprite.
+ */
+void sprite_pool_draw( sprite_pool * pool, pool_sprite_id id );
+
+/*
+ *	sprite_draw_all:
+ *
+ *	Draws every visible sprite in a pool, in slot order.
+ *
+ *	Input:
+ *		pool: The pool.
+ */
+void sprite_draw_all( sprite_pool * pool );
+
+#endif
@@ -4,8 +4,9 @@
 #include <string.h>
 #include "cab202_graphics.h"
 #include "cab202_sprites.h"
-#include "curses.h"
+#include "cab202_bitmap_atlas.h"
 
+static void sprite_release_spans( sprite_id sprite );
 
 /*
 *	Initialise a sprite.
@@ -17,10 +18,8 @@
 *
 *		width, height: The dimensions of the sprite.
 *
-*		bitmap:	The characters to show. A dynamically allocated copy of the bitmap
-*				is created. If you alter the bitmap pointer later, care must be taken
-*				to ensure that memory resources are preserved, restored and deallocated
-*				correctly.
+*		bitmap:	The characters to show. The sprite keeps a reference to the
+*				bitmap, not a copy, so the bitmap must outlive the sprite.
 *
 *	Output:
 *		Returns the address of an initialised sprite object.
@@ -34,7 +33,7 @@ sprite_id sprite_create( double x, double y, int width, int height, char * image
 	sprite_id sprite = malloc( sizeof( sprite_t ) );
 
 	if ( sprite != NULL ) {
-		sprite->is_visible = TRUE;
+		sprite->is_visible = true;
 		sprite->x = x;
 		sprite->y = y;
 		sprite->width = width;
@@ -42,6 +41,10 @@ sprite_id sprite_create( double x, double y, int width, int height, char * image
 		sprite->dx = 0;
 		sprite->dy = 0;
 		sprite->bitmap = image;
+		sprite->span_bitmap = NULL;
+		sprite->spans = NULL;
+		sprite->row_spans = NULL;
+		sprite->image = NO_BITMAP;
 	}
 
 	return sprite;
@@ -53,11 +56,87 @@ sprite_id sprite_create( double x, double y, int width, int height, char * image
 
 void sprite_destroy( sprite_id sprite ) {
 	if ( sprite != NULL ) {
+		sprite_release_spans( sprite );
 		free( sprite );
 	}
 }
 
 
+/*
+ *	Finds the opaque runs of a bitmap. If row_spans and spans are NULL the
+ *	runs are only counted. Returns the number of runs.
+ */
+
+int sprite_find_runs( const char * bitmap, int width, int height, int * row_spans, sprite_span * spans ) {
+	int count = 0;
+
+	for ( int row = 0; row < height; row++ ) {
+		const char * line = bitmap + row * width;
+		int col = 0;
+
+		if ( row_spans != NULL ) row_spans[row] = count;
+
+		while ( col < width ) {
+			while ( col < width && line[col] == ' ' ) col++;
+
+			if ( col >= width ) break;
+
+			int start = col;
+			while ( col < width && line[col] != ' ' ) col++;
+
+			if ( spans != NULL ) {
+				spans[count].col = start;
+				spans[count].length = col - start;
+			}
+
+			count++;
+		}
+	}
+
+	if ( row_spans != NULL ) row_spans[height] = count;
+
+	return count;
+}
+
+/*
+ *	Releases the opaque runs of a sprite. Runs shared with an image in the
+ *	bitmap atlas are not freed; the reference to the image is given up.
+ */
+
+static void sprite_release_spans( sprite_id sprite ) {
+	if ( sprite->image != NO_BITMAP ) {
+		bitmap_release( sprite->image );
+		sprite->image = NO_BITMAP;
+	}
+	else {
+		free( sprite->spans );
+		free( sprite->row_spans );
+	}
+
+	sprite->spans = NULL;
+	sprite->row_spans = NULL;
+	sprite->span_bitmap = NULL;
+}
+
+/*
+ *	Builds the list of opaque runs for the current bitmap of a sprite.
+ *	Returns false if memory could not be allocated.
+ */
+
+static bool sprite_build_spans( sprite_id sprite ) {
+	sprite_release_spans( sprite );
+
+	int count = sprite_find_runs( sprite->bitmap, sprite->width, sprite->height, NULL, NULL );
+	sprite->row_spans = malloc( ( sprite->height + 1 ) * sizeof( int ) );
+	sprite->spans = malloc( ( count > 0 ? count : 1 ) * sizeof( sprite_span ) );
+
+	if ( sprite->row_spans == NULL || sprite->spans == NULL ) return false;
+
+	sprite_find_runs( sprite->bitmap, sprite->width, sprite->height, sprite->row_spans, sprite->spans );
+	sprite->span_bitmap = sprite->bitmap;
+	return true;
+}
+
 /*
  *	Draws the image of a visible sprite.
  *
@@ -75,16 +154,43 @@ void sprite_draw( sprite_id sprite ) {
 
 	int x = (int)round( sprite->x );
 	int y = (int)round( sprite->y );
-	int offset = 0;
 
-	for ( int row = 0; row < sprite->height; row++ ) {
-		for ( int col = 0; col < sprite->width; col++ ) {
-			char ch = sprite->bitmap[offset++] & 0xff;
+	if ( sprite->bitmap != sprite->span_bitmap && !sprite_build_spans( sprite ) ) {
+		// Out of memory: test every cell instead.
+		int offset = 0;
 
-			if ( ch != ' ' ) {
-				draw_char( x + col, y + row, ch );
+		for ( int row = 0; row < sprite->height; row++ ) {
+			for ( int col = 0; col < sprite->width; col++ ) {
+				char ch = sprite->bitmap[offset++] & 0xff;
+
+				if ( ch != ' ' ) {
+					draw_char( x + col, y + row, ch );
+				}
 			}
 		}
+
+		return;
+	}
+
+	// Only visit the rows and runs that can reach the screen.
+	int w = screen_width();
+	int first_row = y < 0 ? -y : 0;
+	int last_row = screen_height() - y;
+
+	if ( last_row > sprite->height ) last_row = sprite->height;
+
+	for ( int row = first_row; row < last_row; row++ ) {
+		char * line = sprite->bitmap + row * sprite->width;
+
+		for ( int i = sprite->row_spans[row]; i < sprite->row_spans[row + 1]; i++ ) {
+			sprite_span * span = &sprite->spans[i];
+
+			if ( x + span->col >= w ) break;
+
+			if ( x + span->col + span->length <= 0 ) continue;
+
+			draw_chars( x + span->col, y + row, line + span->col, span->length );
+		}
 	}
 }
 
@@ -283,5 +389,6 @@ bool sprite_visible( sprite_id sprite ) {
 void sprite_set_image( sprite_id sprite, char * image ) {
 	assert( sprite != NULL );
 	assert( image != NULL );
+	sprite_release_spans( sprite ); // rebuild the runs, even if the image is the same array
 	sprite->bitmap = image;
 }
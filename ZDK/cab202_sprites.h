@@ -34,14 +34,33 @@
  *
  *		bitmap: an array of characters that represents the image. ' ' (space) is 
  *				treated as transparent.
+ *
+ *		spans, row_spans, span_bitmap: The opaque runs of the bitmap, used by
+ *				sprite_draw. row_spans[r] .. row_spans[r+1] - 1 index the runs on
+ *				row r. The runs are rebuilt when bitmap no longer equals
+ *				span_bitmap, so call sprite_set_image after changing the
+ *				characters of an image in place.
+ *
+ *		image:	The bitmap atlas image shown by the sprite, which owns bitmap
+ *				and the runs, or 0 if the sprite owns its runs. See
+ *				cab202_bitmap_atlas.h.
  */
 
+typedef struct sprite_span {
+	int col;
+	int length;
+} sprite_span;
+
 typedef struct sprite {
 	int width;
 	int height;
 	double x, y, dx, dy;
 	bool is_visible;
 	char * bitmap;
+	char * span_bitmap;
+	sprite_span * spans;
+	int * row_spans;
+	int image;
 } sprite_t;
 
 /* 
@@ -60,10 +79,8 @@ typedef sprite_t * sprite_id;
  *
  *		width, height: The dimensions of the sprite.
  *
- *		bitmap:	The characters to show. A dynamically allocated copy of the bitmap
- *				is created. If you alter the bitmap pointer later, care must be taken 
- *				to ensure that memory resources are preserved, restored and deallocated 
- *				correctly.
+ *		bitmap:	The characters to show. The sprite keeps a reference to the
+ *				bitmap, not a copy, so the bitmap must outlive the sprite.
  *
  *	Output:
  *		Returns the address of an initialised sprite object.
@@ -82,6 +99,10 @@ void sprite_destroy( sprite_id sprite );
  *	bitmap is drawn at the screen coordinate closest to the (x,y)
  *	position of the sprite.
  *
+ *	Each row is drawn as a few runs of opaque characters, built when the
+ *	image is set. Rows and runs which lie entirely off the screen are
+ *	skipped without being examined.
+ *
  *	Input:
  *	-	id: The ID of the sprite which is to be made visible.
  *
@@ -224,4 +245,19 @@ bool sprite_visible( sprite_id sprite );
  */
 void sprite_set_image( sprite_id sprite, char * image );
 
+/*
+ *	Finds the runs of opaque characters in a bitmap, as used by sprite_draw.
+ *
+ *	Input:
+ *		bitmap: The characters of the image, row by row.
+ *		width, height: The dimensions of the image.
+ *		row_spans: If not NULL, receives the index of the first run on each
+ *			row, followed by the total number of runs (height + 1 elements).
+ *		spans: If not NULL, receives the runs.
+ *
+ *	Output:
+ *		Returns the number of runs.
+ */
+int sprite_find_runs( const char * bitmap, int width, int height, int * row_spans, sprite_span * spans );
+
 #endif
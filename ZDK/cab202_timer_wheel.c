@@ -0,0 +1,330 @@
+/*
+ *	cab202_timer_wheel.c
+ *
+ *	A hierarchical timing wheel. See cab202_timer_wheel.h.
+ *
+ *	Each pending timer sits in a doubly linked list, threaded through the
+ *	pool by index, belonging to one slot of one level. A timer due within
+ *	64 ticks sits on level 0, in the slot for the tick it is due. Later
+ *	timers sit on the coarsest level whose slots are fine enough to tell
+ *	their tick apart from the current one; whenever the time crosses a
+ *	slot boundary of a level, the timers of the slot being entered are
+ *	moved down ("cascaded") to the levels below.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cab202_timer_wheel.h"
+
+#define SLOT_MASK ( WHEEL_SLOTS - 1 )
+#define LEVEL_SHIFT( level ) ( ( level ) * WHEEL_SLOT_BITS )
+#define LEVEL_SPAN( level ) ( 1LL << LEVEL_SHIFT( level ) )
+
+#define INDEX_BITS 16
+#define INDEX_MASK ( ( 1 << INDEX_BITS ) - 1 )
+#define GENERATION_MASK 0x7fff
+
+/*
+ *	Level of a timer which has fallen due and is waiting for its callback
+ *	to be called, in the list headed by wheel->firing.
+ */
+#define LEVEL_FIRING WHEEL_LEVELS
+
+/*
+ *	Level of a timer which is in the free list.
+ */
+#define LEVEL_FREE (-1)
+
+/*
+ *	A timer in the pool.
+ *
+ *	Members:
+ *		expires:	The tick on which the timer is next due.
+ *		period:		The interval between repeats, or 0.
+ *		callback, data, event: As given to timer_wheel_schedule.
+ *		prev, next:	Neighbours in the list holding the timer, or -1.
+ *		generation:	Bumped when the timer returns to the pool, to tell its
+ *					identifiers apart from those of the next use.
+ *		level, slot: The list holding the timer.
+ */
+struct wheel_timer {
+	long long expires;
+	long long period;
+	wheel_callback callback;
+	void * data;
+	int event;
+	int prev, next;
+	int generation;
+	int level, slot;
+};
+
+static int * list_head( timer_wheel * wheel, struct wheel_timer * timer ) {
+	return timer->level == LEVEL_FIRING ? &wheel->firing : &wheel->slots[timer->level][timer->slot];
+}
+
+static void push( timer_wheel * wheel, int index, int level, int slot ) {
+	struct wheel_timer * timer = &wheel->timers[index];
+	timer->level = level;
+	timer->slot = slot;
+
+	int * head = list_head( wheel, timer );
+	timer->prev = -1;
+	timer->next = *head;
+	if ( *head >= 0 ) wheel->timers[*head].prev = index;
+	*head = index;
+}
+
+static void detach( timer_wheel * wheel, int index ) {
+	struct wheel_timer * timer = &wheel->timers[index];
+	int * head = list_head( wheel, timer );
+
+	if ( timer->prev >= 0 ) wheel->timers[timer->prev].next = timer->next;
+	else *head = timer->next;
+	if ( timer->next >= 0 ) wheel->timers[timer->next].prev = timer->prev;
+}
+
+/**
+ *	Places a timer in the slot for its expiry, relative to the next tick
+ *	to be processed.
+ */
+static void place( timer_wheel * wheel, int index ) {
+	long long base = wheel->now + 1;
+	long long expires = wheel->timers[index].expires;
+	long long delta = expires - base;
+	int level = 0;
+
+	if ( delta < 0 ) {
+		expires = base;
+	}
+	else if ( delta >= LEVEL_SPAN( WHEEL_LEVELS ) ) {
+		// Beyond the wheel: carried in the furthest slot of the top level,
+		// and placed again each time that slot is cascaded.
+		level = WHEEL_LEVELS - 1;
+		expires = base + LEVEL_SPAN( WHEEL_LEVELS ) - 1;
+	}
+	else {
+		while ( delta >= LEVEL_SPAN( level + 1 ) ) level++;
+	}
+
+	push( wheel, index, level, ( expires >> LEVEL_SHIFT( level ) ) & SLOT_MASK );
+}
+
+static void release( timer_wheel * wheel, int index ) {
+	struct wheel_timer * timer = &wheel->timers[index];
+	timer->level = LEVEL_FREE;
+	timer->generation = ( timer->generation + 1 ) & GENERATION_MASK;
+	timer->next = wheel->free_list;
+	wheel->free_list = index;
+	wheel->live--;
+}
+
+static struct wheel_timer * lookup( timer_wheel * wheel, wheel_timer_id id ) {
+	if ( id < 0 ) return NULL;
+
+	int index = id & INDEX_MASK;
+	if ( index >= wheel->capacity ) return NULL;
+
+	struct wheel_timer * timer = &wheel->timers[index];
+	if ( timer->level == LEVEL_FREE || timer->generation != id >> INDEX_BITS ) return NULL;
+
+	return timer;
+}
+
+/**
+ *	Allocates the pool of a wheel.
+ */
+bool timer_wheel_init( timer_wheel * wheel, int capacity ) {
+	assert( wheel != NULL );
+	assert( capacity > 0 && capacity <= INDEX_MASK + 1 );
+
+	memset( wheel, 0, sizeof( timer_wheel ) );
+	wheel->timers = calloc( capacity, sizeof( struct wheel_timer ) );
+
+	if ( wheel->timers == NULL ) return false;
+
+	wheel->capacity = capacity;
+	timer_wheel_clear( wheel );
+	return true;
+}
+
+/**
+ *	Frees the pool of a wheel.
+ */
+void timer_wheel_release( timer_wheel * wheel ) {
+	assert( wheel != NULL );
+
+	free( wheel->timers );
+	memset( wheel, 0, sizeof( timer_wheel ) );
+}
+
+/**
+ *	Returns every timer to the pool. Timers which were pending get a new
+ *	generation, so their identifiers no longer match.
+ */
+void timer_wheel_clear( timer_wheel * wheel ) {
+	assert( wheel != NULL );
+
+	for ( int i = wheel->capacity - 1; i >= 0; i-- ) {
+		struct wheel_timer * timer = &wheel->timers[i];
+
+		if ( timer->level != LEVEL_FREE ) {
+			timer->generation = ( timer->generation + 1 ) & GENERATION_MASK;
+		}
+
+		timer->level = LEVEL_FREE;
+		timer->next = i + 1 < wheel->capacity ? i + 1 : -1;
+	}
+
+	memset( wheel->slots, -1, sizeof( wheel->slots ) );
+	wheel->free_list = wheel->capacity > 0 ? 0 : -1;
+	wheel->firing = -1;
+	wheel->live = 0;
+	wheel->now = 0;
+}
+
+/**
+ *	Copies the pool and lists of a wheel, then moves data pointers into
+ *	from_data across to to_data.
+ */
+void timer_wheel_copy( timer_wheel * to, const timer_wheel * from,
+	const void * from_data, void * to_data, size_t size ) {
+	assert( to != NULL && from != NULL );
+	assert( to->capacity == from->capacity );
+
+	struct wheel_timer * timers = to->timers;
+	*to = *from;
+	to->timers = timers;
+	memcpy( timers, from->timers, from->capacity * sizeof( struct wheel_timer ) );
+
+	uintptr_t start = (uintptr_t) from_data;
+
+	for ( int i = 0; i < to->capacity; i++ ) {
+		uintptr_t data = (uintptr_t) timers[i].data;
+
+		if ( timers[i].level != LEVEL_FREE && data >= start && data - start < size ) {
+			timers[i].data = (char *) to_data + ( data - start );
+		}
+	}
+}
+
+/**
+ *	Takes a timer from the pool and places it on the wheel.
+ */
+wheel_timer_id timer_wheel_schedule( timer_wheel * wheel, long long delay, long long period,
+	int event, wheel_callback callback, void * data ) {
+	assert( wheel != NULL );
+	assert( callback != NULL );
+
+	int index = wheel->free_list;
+	if ( index < 0 ) return NO_WHEEL_TIMER;
+
+	struct wheel_timer * timer = &wheel->timers[index];
+	wheel->free_list = timer->next;
+	wheel->live++;
+
+	timer->expires = wheel->now + ( delay > 1 ? delay : 1 );
+	timer->period = period > 0 ? period : 0;
+	timer->callback = callback;
+	timer->data = data;
+	timer->event = event;
+	place( wheel, index );
+
+	return timer->generation << INDEX_BITS | index;
+}
+
+/**
+ *	Takes a pending timer off the wheel and returns it to the pool.
+ */
+bool timer_wheel_cancel( timer_wheel * wheel, wheel_timer_id id ) {
+	assert( wheel != NULL );
+
+	struct wheel_timer * timer = lookup( wheel, id );
+	if ( timer == NULL ) return false;
+
+	int index = id & INDEX_MASK;
+	detach( wheel, index );
+	release( wheel, index );
+	return true;
+}
+
+/**
+ *	Gets the number of ticks until a timer is next due.
+ */
+long long timer_wheel_remaining( timer_wheel * wheel, wheel_timer_id id ) {
+	assert( wheel != NULL );
+
+	struct wheel_timer * timer = lookup( wheel, id );
+	if ( timer == NULL ) return -1;
+
+	return timer->expires > wheel->now ? timer->expires - wheel->now : 0;
+}
+
+/**
+ *	Moves the timers of one slot down to the levels below.
+ */
+static void cascade( timer_wheel * wheel, int level, int slot ) {
+	int index = wheel->slots[level][slot];
+	wheel->slots[level][slot] = -1;
+
+	while ( index >= 0 ) {
+		int next = wheel->timers[index].next;
+		place( wheel, index );
+		index = next;
+	}
+}
+
+/**
+ *	Processes ticks in turn. For each, cascades the slots being entered,
+ *	then moves the timers due on that tick to the firing list and calls
+ *	them one at a time. Repeating timers are placed again before their
+ *	callback runs, so the callback may cancel them.
+ */
+void timer_wheel_advance( timer_wheel * wheel, long long ticks ) {
+	assert( wheel != NULL );
+
+	while ( ticks-- > 0 ) {
+		if ( wheel->live == 0 ) {
+			wheel->now += ticks + 1;
+			return;
+		}
+
+		long long tick = wheel->now + 1;
+
+		for ( int level = 1; level < WHEEL_LEVELS; level++ ) {
+			if ( ( tick & ( LEVEL_SPAN( level ) - 1 ) ) != 0 ) break;
+			cascade( wheel, level, ( tick >> LEVEL_SHIFT( level ) ) & SLOT_MASK );
+		}
+
+		int * slot = &wheel->slots[0][tick & SLOT_MASK];
+		wheel->firing = *slot;
+		*slot = -1;
+
+		for ( int index = wheel->firing; index >= 0; index = wheel->timers[index].next ) {
+			wheel->timers[index].level = LEVEL_FIRING;
+		}
+
+		wheel->now = tick;
+
+		while ( wheel->firing >= 0 ) {
+			int index = wheel->firing;
+			struct wheel_timer * timer = &wheel->timers[index];
+			detach( wheel, index );
+
+			wheel_callback callback = timer->callback;
+			void * data = timer->data;
+			int event = timer->event;
+
+			if ( timer->period > 0 ) {
+				timer->expires += timer->period;
+				place( wheel, index );
+			}
+			else {
+				release( wheel, index );
+			}
+
+			callback( data, event );
+		}
+	}
+}
@@ -0,0 +1,206 @@
+/*
+ *	cab202_timer_wheel.h
+ *
+ *	A hierarchical timing wheel, for programs which keep many timers
+ *	running at once.
+ *
+ *	Time on a wheel is counted in ticks, which the program advances
+ *	itself, typically once per simulation step. A timer fires after a
+ *	given number of ticks, optionally repeating, by calling a function
+ *	with the event number it was scheduled with. Scheduling and cancelling
+ *	a timer take constant time, however many timers are running, and
+ *	advancing the wheel only visits the timers which fall due (plus, every
+ *	64 ticks, the few being moved to a finer level of the wheel).
+ *
+ *	Timers are allocated from a pool of fixed size, created by
+ *	timer_wheel_init, so scheduling never touches the heap and a timer
+ *	cannot leak: timer_wheel_clear returns every timer to the pool.
+ */
+
+#ifndef __CAB202_TIMER_WHEEL_H__
+#define __CAB202_TIMER_WHEEL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ *	The wheel has WHEEL_LEVELS levels of WHEEL_SLOTS slots. Each slot of
+ *	level n spans 64^n ticks, so timers up to 64^4 ticks ahead are placed
+ *	directly; later ones are carried on the top level until they come
+ *	within range.
+ */
+#define WHEEL_SLOT_BITS 6
+#define WHEEL_SLOTS ( 1 << WHEEL_SLOT_BITS )
+#define WHEEL_LEVELS 4
+
+/*
+ *	Identifies a timer on a wheel. An identifier stays distinct from those
+ *	of later timers using the same slot of the pool, so cancelling a timer
+ *	which has already fired is harmless.
+ */
+typedef int wheel_timer_id;
+
+/*
+ *	Value denoting no timer. Returned by timer_wheel_schedule when the pool
+ *	is exhausted.
+ */
+#define NO_WHEEL_TIMER (-1)
+
+/*
+ *	Function called when a timer fires.
+ *
+ *	Input:
+ *		data: The pointer given when the timer was scheduled.
+ *		event: The event number given when the timer was scheduled.
+ */
+typedef void ( * wheel_callback )( void * data, int event );
+
+/*
+ *	A timer in the pool. See cab202_timer_wheel.c.
+ */
+struct wheel_timer;
+
+/*
+ *	A timing wheel.
+ *
+ *	Members:
+ *		now:		The number of ticks the wheel has advanced.
+ *		capacity:	The number of timers in the pool.
+ *		live:		The number of timers scheduled and not yet fired or cancelled.
+ *		timers:		The pool.
+ *		free_list:	The first unused timer in the pool, or -1.
+ *		firing:		The first timer due on the current tick whose callback
+ *					has not yet been called, or -1.
+ *		slots:		The first timer in each slot of each level, or -1.
+ */
+typedef struct timer_wheel {
+	long long now;
+	int capacity;
+	int live;
+	struct wheel_timer * timers;
+	int free_list;
+	int firing;
+	int slots[WHEEL_LEVELS][WHEEL_SLOTS];
+} timer_wheel;
+
+/*
+ *	timer_wheel_init:
+ *
+ *	Allocates the pool of a wheel. The wheel starts at time zero, with no
+ *	timers.
+ *
+ *	Input:
+ *		wheel: The wheel to initialise.
+ *		capacity: The most timers which can be scheduled at once, at most 65536.
+ *
+ *	Output:
+ *		Returns false if memory could not be allocated.
+ */
+bool timer_wheel_init( timer_wheel * wheel, int capacity );
+
+/*
+ *	timer_wheel_release:
+ *
+ *	Frees the pool of a wheel. The wheel may be initialised again afterwards.
+ *
+ *	Input:
+ *		wheel: The wheel.
+ */
+void timer_wheel_release( timer_wheel * wheel );
+
+/*
+ *	timer_wheel_clear:
+ *
+ *	Cancels every timer on a wheel and sets its time back to zero.
+ *
+ *	Input:
+ *		wheel: The wheel.
+ */
+void timer_wheel_clear( timer_wheel * wheel );
+
+/*
+ *	timer_wheel_copy:
+ *
+ *	Makes one wheel the same as another, timers, time and all, without
+ *	allocating, so that a copy of a simulation can be run ahead and
+ *	thrown away.
+ *
+ *	A timer's data usually points into the state the simulation is made
+ *	of, which is copied along with the wheel. Timers whose data points
+ *	into the size bytes at from_data are pointed at the same place in the
+ *	size bytes at to_data, so that they act on the copy of the state.
+ *
+ *	Input:
+ *		to: The wheel to overwrite. Its pool must be the same size.
+ *		from: The wheel copied.
+ *		from_data, to_data, size: The state copied along with the wheel.
+ */
+void timer_wheel_copy( timer_wheel * to, const timer_wheel * from,
+	const void * from_data, void * to_data, size_t size );
+
+/*
+ *	timer_wheel_schedule:
+ *
+ *	Starts a timer.
+ *
+ *	Input:
+ *		wheel: The wheel.
+ *		delay: The number of ticks until the timer fires. A delay of 0 or 1
+ *			fires on the next tick.
+ *		period: If greater than zero, the timer fires again every period
+ *			ticks until cancelled. Otherwise it fires once.
+ *		event: A number passed to the callback, so one function can
+ *			handle several kinds of event.
+ *		callback: The function called when the timer fires.
+ *		data: A pointer passed to the callback.
+ *
+ *	Output:
+ *		Returns the timer, or NO_WHEEL_TIMER if the pool is exhausted.
+ */
+wheel_timer_id timer_wheel_schedule( timer_wheel * wheel, long long delay, long long period,
+	int event, wheel_callback callback, void * data );
+
+/*
+ *	timer_wheel_cancel:
+ *
+ *	Stops a timer before it fires.
+ *
+ *	Input:
+ *		wheel: The wheel.
+ *		id: The timer. Timers which have already fired, or NO_WHEEL_TIMER, are ignored.
+ *
+ *	Output:
+ *		Returns true if and only if the timer was pending.
+ */
+bool timer_wheel_cancel( timer_wheel * wheel, wheel_timer_id id );
+
+/*
+ *	timer_wheel_remaining:
+ *
+ *	Gets the number of ticks until a timer next fires.
+ *
+ *	Input:
+ *		wheel: The wheel.
+ *		id: The timer.
+ *
+ *	Output:
+ *		Returns the number of ticks, or -1 if the timer is not pending.
+ */
+long long timer_wheel_remaining( timer_wheel * wheel, wheel_timer_id id );
+
+/*
+ *	timer_wheel_advance:
+ *
+ *	Advances the time of a wheel, one tick at a time, calling the callback
+ *	of each timer as it falls due. Timers falling due on the same tick fire
+ *	in an unspecified, but repeatable, order. Callbacks may schedule and
+ *	cancel timers, including their own, but must not advance or clear the
+ *	wheel.
+ *
+ *	Input:
+ *		wheel: The wheel.
+ *		ticks: The number of ticks to advance.
+ */
+void timer_wheel_advance( timer_wheel * wheel, long long ticks );
+
+#endif
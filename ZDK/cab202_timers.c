@@ -7,8 +7,14 @@
 #include <windows.h>
 #else
 #include <time.h>
+#include <errno.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <poll.h>
+#endif
+
+#if defined(__linux__) && !defined(ZDK_VIRTUAL_CLOCK)
+#include <sys/timerfd.h>
 #endif
 
 #ifdef __MACH__
@@ -16,6 +22,22 @@
 #include <mach/mach.h>
 #endif
 
+#ifdef ZDK_VIRTUAL_CLOCK
+/*
+ *	Simulated time, in nanoseconds, used by headless builds of the library.
+ *	It starts at zero and only advances when the program pauses, so a
+ *	session runs as fast as the processor allows and is independent of
+ *	the wall clock.
+ */
+static timer_ns virtual_ns = 0;
+#endif
+
+/*
+ *	Time sampled by timer_begin_frame, and whether it has been called.
+ */
+static timer_ns frame_ns = 0;
+static bool frame_started = false;
+
 /*
 *	Creates a new timer and sets it up with the required interval.
 *
@@ -53,7 +75,7 @@ timer_id create_timer( long milliseconds ) {
 void timer_reset( timer_id timer ) {
 	assert( timer != NULL );
 
-	timer->reset_time = get_current_time();
+	timer->reset_ns = get_frame_ns();
 }
 
 
@@ -73,9 +95,8 @@ void timer_reset( timer_id timer ) {
 bool timer_expired( timer_id timer ) {
 	assert( timer != NULL );
 
-	double current_time = get_current_time();
-	double time_diff = current_time - timer->reset_time;
-	int expired = time_diff * MILLISECONDS >= timer->milliseconds;
+	timer_ns time_diff = get_frame_ns() - timer->reset_ns;
+	int expired = time_diff >= (timer_ns) timer->milliseconds * ( NANOSECONDS / MILLISECONDS );
 
 	if ( expired ) {
 		timer_reset( timer );
@@ -98,7 +119,9 @@ bool timer_expired( timer_id timer ) {
 */
 
 void timer_pause( long milliseconds ) {
-#ifdef WIN32
+#if defined(ZDK_VIRTUAL_CLOCK)
+	virtual_ns += (timer_ns) milliseconds * ( NANOSECONDS / MILLISECONDS );
+#elif defined(WIN32)
 	Sleep( milliseconds );
 #else
 	/* usleep requires input in microseconds rather than milliseconds. */
@@ -106,7 +129,263 @@ void timer_pause( long milliseconds ) {
 #endif
 }
 
-#ifdef WIN32
+/*
+*	timer_sleep_until:
+*
+*	Pauses execution until the monotonic clock reaches a deadline.
+*
+*	Input:
+*		deadline: The time to wake, on the get_monotonic_ns clock.
+*
+*	Output: void.
+*/
+
+void timer_sleep_until( timer_ns deadline ) {
+#if defined(ZDK_VIRTUAL_CLOCK)
+	if ( deadline > virtual_ns ) virtual_ns = deadline;
+#elif defined(WIN32)
+	timer_ns wait = deadline - get_monotonic_ns();
+
+	if ( wait > 0 ) Sleep( (DWORD) ( ( wait + 999999 ) / 1000000 ) );
+#elif defined(__MACH__)
+	timer_ns wait = deadline - get_monotonic_ns();
+	struct timespec t = { wait / NANOSECONDS, wait % NANOSECONDS };
+
+	while ( wait > 0 && nanosleep( &t, &t ) == -1 && errno == EINTR ) {}
+#else
+	/* An absolute deadline does not drift however long the caller took to get here. */
+	struct timespec t = { deadline / NANOSECONDS, deadline % NANOSECONDS };
+
+	while ( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL ) == EINTR ) {}
+#endif
+}
+
+/*
+*	timer_wait_fd:
+*
+*	Waits for input on a file descriptor, or for a deadline.
+*
+*	Input:
+*		fd: The descriptor to watch, or -1.
+*		deadline: The time to give up, on the get_monotonic_ns clock.
+*
+*	Output: Returns true if fd has input to read.
+*/
+
+bool timer_wait_fd( int fd, timer_ns deadline ) {
+#if defined(WIN32)
+	( void ) fd;
+	timer_sleep_until( deadline );
+	return false;
+#else
+	struct pollfd fds[2] = { { fd, POLLIN, 0 }, { -1, POLLIN, 0 } };
+
+	if ( fd >= 0 && poll( fds, 1, 0 ) > 0 ) {
+		if ( fds[0].revents & POLLIN ) return true;
+
+		/* Closed or broken: it would wake every poll, so just wait for the deadline. */
+		fd = fds[0].fd = -1;
+	}
+
+#if defined(ZDK_VIRTUAL_CLOCK)
+	timer_sleep_until( deadline );
+	return false;
+#elif defined(__linux__)
+	/* Created once and re-armed on every call; a poll timeout would only have millisecond resolution. */
+	static int timer_fd = -1;
+
+	if ( timer_fd < 0 ) timer_fd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+
+	struct itimerspec when = { { 0, 0 }, { deadline / NANOSECONDS, deadline % NANOSECONDS } };
+
+	if ( timer_fd < 0 || deadline <= 0 || timerfd_settime( timer_fd, TFD_TIMER_ABSTIME, &when, NULL ) != 0 ) {
+		timer_sleep_until( deadline );
+		return false;
+	}
+
+	fds[1].fd = timer_fd;
+
+	while ( poll( fds, 2, -1 ) == -1 && errno == EINTR ) {}
+
+	if ( fds[1].revents & POLLIN ) {
+		unsigned long long expirations;
+		while ( read( timer_fd, &expirations, sizeof( expirations ) ) > 0 ) {}
+	}
+
+	return ( fds[0].revents & POLLIN ) != 0;
+#else
+	timer_ns wait = deadline - get_monotonic_ns();
+
+	while ( wait > 0 ) {
+		int result = poll( fds, fd >= 0 ? 1 : 0, (int) ( ( wait + 999999 ) / 1000000 ) );
+
+		if ( result > 0 ) return ( fds[0].revents & POLLIN ) != 0;
+		if ( result == 0 || errno != EINTR ) break;
+
+		wait = deadline - get_monotonic_ns();
+	}
+
+	return false;
+#endif
+#endif
+}
+
+/*
+*	Converts the monotonic clock to seconds.
+*/
+
+double get_current_time() {
+	return (double) get_monotonic_ns() / NANOSECONDS;
+}
+
+/*
+*	Samples the clock once for the coming frame.
+*/
+
+void timer_begin_frame( void ) {
+	frame_ns = get_monotonic_ns();
+	frame_started = true;
+}
+
+/*
+*	Gets the time of the current frame.
+*/
+
+timer_ns get_frame_ns( void ) {
+	return frame_started ? frame_ns : get_monotonic_ns();
+}
+
+/*
+*	Sets up a scheduler for ticks of a fixed length.
+*/
+
+void scheduler_init( tick_scheduler * scheduler, long milliseconds, int max_catch_up ) {
+	assert( scheduler != NULL );
+	assert( milliseconds > 0 );
+	assert( max_catch_up >= 1 );
+
+	scheduler->step_ns = (timer_ns) milliseconds * ( NANOSECONDS / MILLISECONDS );
+	scheduler->max_catch_up = max_catch_up;
+	scheduler->ticks = 0;
+	scheduler->dropped = 0;
+	scheduler->late_min = 0;
+	scheduler->late_max = 0;
+	scheduler->late_sum = 0;
+	scheduler->late_sum_sq = 0;
+	scheduler_restart( scheduler );
+}
+
+/*
+*	Makes the next tick fall due one tick from now.
+*/
+
+void scheduler_restart( tick_scheduler * scheduler ) {
+	assert( scheduler != NULL );
+
+	scheduler->next_ns = get_frame_ns() + scheduler->step_ns;
+}
+
+/*
+*	Counts the ticks due by the frame time, recording how late each is run.
+*/
+
+int scheduler_ticks_due( tick_scheduler * scheduler ) {
+	assert( scheduler != NULL );
+
+	timer_ns now = get_frame_ns();
+
+	if ( now < scheduler->next_ns ) return 0;
+
+	long long due = ( now - scheduler->next_ns ) / scheduler->step_ns + 1;
+	int run = due < scheduler->max_catch_up ? (int) due : scheduler->max_catch_up;
+
+	// The oldest ticks are the ones dropped; those run are the most recent.
+	scheduler->dropped += due - run;
+	scheduler->next_ns += ( due - run ) * scheduler->step_ns;
+
+	for ( int i = 0; i < run; i++ ) {
+		timer_ns late = now - scheduler->next_ns;
+
+		if ( scheduler->ticks == 0 || late < scheduler->late_min ) scheduler->late_min = late;
+		if ( scheduler->ticks == 0 || late > scheduler->late_max ) scheduler->late_max = late;
+
+		scheduler->late_sum += late;
+		scheduler->late_sum_sq += (double) late * late;
+		scheduler->ticks++;
+		scheduler->next_ns += scheduler->step_ns;
+	}
+
+	return run;
+}
+
+/*
+*	Pauses until the next tick is due, or for at most max_milliseconds.
+*/
+
+void scheduler_sleep( tick_scheduler * scheduler, long max_milliseconds ) {
+	assert( scheduler != NULL );
+
+	timer_ns limit = get_monotonic_ns() + (timer_ns) max_milliseconds * ( NANOSECONDS / MILLISECONDS );
+
+	timer_sleep_until( scheduler->next_ns < limit ? scheduler->next_ns : limit );
+}
+
+/*
+*	Square root by Newton's method, so that the library does not need libm.
+*/
+
+static double square_root( double v ) {
+	if ( v <= 0 ) return 0;
+
+	double r = v > 1 ? v : 1;
+
+	for ( int i = 0; i < 100; i++ ) {
+		double next = ( r + v / r ) / 2;
+
+		if ( next >= r ) break;
+
+		r = next;
+	}
+
+	return r;
+}
+
+/*
+*	Summarises how late ticks have been run.
+*/
+
+void scheduler_stats( tick_scheduler * scheduler, tick_stats * stats ) {
+	assert( scheduler != NULL );
+	assert( stats != NULL );
+
+	double ns_per_ms = NANOSECONDS / MILLISECONDS;
+	long long n = scheduler->ticks;
+
+	stats->ticks = n;
+	stats->dropped = scheduler->dropped;
+	stats->mean_ms = 0;
+	stats->sd_ms = 0;
+	stats->min_ms = scheduler->late_min / ns_per_ms;
+	stats->max_ms = scheduler->late_max / ns_per_ms;
+
+	if ( n > 0 ) {
+		double mean = scheduler->late_sum / n;
+		double variance = scheduler->late_sum_sq / n - mean * mean;
+
+		stats->mean_ms = mean / ns_per_ms;
+		stats->sd_ms = square_root( variance ) / ns_per_ms;
+	}
+}
+
+timer_ns get_monotonic_ns( void ) {
+#if defined(ZDK_VIRTUAL_CLOCK)
+	return virtual_ns;
+#else
+	return get_host_ns();
+#endif
+}
+
+#if defined(WIN32)
 /*
 	Implementation of clock_gettime sourced from StackOverflow:
 	http://stackoverflow.com/questions/5404277/porting-clock-gettime-to-windows
@@ -171,28 +450,28 @@ int clock_gettime( int X, struct timeval *tv ) {
 	return ( 0 );
 }
 
-double get_current_time() {
-	struct timeval timeval;
+timer_ns get_host_ns( void ) {
+	struct timeval timeval; // performance counter, relative to the first call
 	clock_gettime( 0, &timeval );
-	return timeval.tv_sec + timeval.tv_usec / 1.0e+6;
+	return (timer_ns) timeval.tv_sec * NANOSECONDS + (timer_ns) timeval.tv_usec * 1000;
 }
 #else 
-double get_current_time () {
+timer_ns get_host_ns( void ) {
 	struct timespec timeval;
 
 #ifdef __MACH__ // OS X does not have clock_gettime, use clock_get_time
 	clock_serv_t cclock;
 	mach_timespec_t mts;
-	host_get_clock_service(mach_host_self(), CALENDAR_CLOCK, &cclock);
+	host_get_clock_service(mach_host_self(), SYSTEM_CLOCK, &cclock); // uptime, not calendar
 	clock_get_time(cclock, &mts);
 	mach_port_deallocate(mach_task_self(), cclock);
 	timeval.tv_sec = mts.tv_sec;
 	timeval.tv_nsec = mts.tv_nsec;
 #else
 	/* http://linux.die.net/man/3/clock_gettime */
-	clock_gettime( CLOCK_REALTIME, &timeval );
+	clock_gettime( CLOCK_MONOTONIC, &timeval );
 #endif
 
-	return timeval.tv_sec + timeval.tv_nsec / 1.0e+9;
+	return (timer_ns) timeval.tv_sec * NANOSECONDS + timeval.tv_nsec;
 }
 #endif
@@ -9,19 +9,63 @@
 #define __TIMER_H__
 
 #include <stdbool.h>
+#include <stdint.h>
 
 /*	Constant number of milliseconds in a second. */
 #define MILLISECONDS 1000
 
+/*	Constant number of nanoseconds in a second. */
+#define NANOSECONDS 1000000000LL
+
+/*	A time or duration in nanoseconds, measured by a monotonic clock. */
+typedef int64_t timer_ns;
+
 /*	Data structure to keep track of elapsed time. */
 typedef struct {
-	double reset_time;
+	timer_ns reset_ns;
 	long milliseconds;
 } cab202_timer_t;
 
 /*	Data type to represent unique timer ID. */
 typedef cab202_timer_t * timer_id;
 
+/*
+ *	Data structure which runs simulation ticks of fixed length at a steady
+ *	rate (see scheduler_init).
+ *
+ *	Members:
+ *		step_ns:		The length of a tick.
+ *		next_ns:		The deadline of the next tick.
+ *		max_catch_up:	The most ticks run at once after a stall.
+ *
+ *		ticks:			The number of ticks run.
+ *		dropped:		The number of ticks skipped because they exceeded max_catch_up.
+ *		late_min, late_max, late_sum, late_sum_sq: How late ticks were run,
+ *						measured from their deadlines to the frame time.
+ */
+typedef struct {
+	timer_ns step_ns;
+	timer_ns next_ns;
+	int max_catch_up;
+
+	long long ticks;
+	long long dropped;
+	timer_ns late_min;
+	timer_ns late_max;
+	double late_sum;
+	double late_sum_sq;
+} tick_scheduler;
+
+/*	Summary of the timing of the ticks run by a scheduler, in milliseconds. */
+typedef struct {
+	long long ticks;
+	long long dropped;
+	double mean_ms;
+	double sd_ms;
+	double min_ms;
+	double max_ms;
+} tick_stats;
+
 /*
  *	create_timer:
  *
@@ -81,7 +125,8 @@ void timer_pause( long milliseconds );
 /**
  *	get_current_time:
  *
- *	Gets an estimate of the elapsed system time.
+ *	Gets an estimate of the elapsed system time. This is get_monotonic_ns
+ *	converted to seconds, kept for existing programs.
  *
  *	Input: no input.
  *
@@ -89,4 +134,170 @@ void timer_pause( long milliseconds );
  */
 double get_current_time();
 
+/**
+ *	get_monotonic_ns:
+ *
+ *	Reads a clock which only ever moves forward at a steady rate, unaffected
+ *	by changes to the wall clock. Its starting point is unspecified, so only
+ *	differences between readings are meaningful.
+ *
+ *	Input: no input.
+ *
+ *	Output: Returns the current time in nanoseconds.
+ */
+timer_ns get_monotonic_ns( void );
+
+/**
+ *	get_host_ns:
+ *
+ *	Reads the host's monotonic clock. This is the clock behind
+ *	get_monotonic_ns, except in headless builds, where get_monotonic_ns
+ *	is simulated and this still measures real time, e.g. to time how long
+ *	code takes to run.
+ *
+ *	Input: no input.
+ *
+ *	Output: Returns the current time in nanoseconds.
+ */
+timer_ns get_host_ns( void );
+
+/**
+ *	timer_begin_frame:
+ *
+ *	Samples the monotonic clock once, as the time of the frame about to be
+ *	processed. Until the next call, timer_expired, timer_reset and
+ *	get_frame_ns all use this time rather than reading the clock again, so
+ *	everything done during one pass of a game loop sees the same time.
+ *
+ *	Programs which never call timer_begin_frame get the time of each call.
+ *
+ *	Input: no input.
+ *
+ *	Output: void.
+ */
+void timer_begin_frame( void );
+
+/**
+ *	get_frame_ns:
+ *
+ *	Gets the time sampled by the last call to timer_begin_frame, or the
+ *	current time if it has never been called.
+ *
+ *	Input: no input.
+ *
+ *	Output: Returns the frame time in nanoseconds, on the get_monotonic_ns clock.
+ */
+timer_ns get_frame_ns( void );
+
+/**
+ *	timer_sleep_until:
+ *
+ *	Pauses execution until the monotonic clock reaches a deadline. Where
+ *	the system allows, the deadline is passed to the system as an absolute
+ *	time, so time spent before the call does not delay waking up.
+ *
+ *	Input:
+ *		deadline: The time to wake, on the get_monotonic_ns clock.
+ *
+ *	Output: void.
+ */
+void timer_sleep_until( timer_ns deadline );
+
+/**
+ *	timer_wait_fd:
+ *
+ *	Pauses execution until a file descriptor has input to read, or the
+ *	monotonic clock reaches a deadline, whichever comes first. On Linux the
+ *	deadline is armed on a timerfd as an absolute time and both are waited
+ *	for with a single poll, so the caller wakes as soon as either is ready
+ *	and not before.
+ *
+ *	Headless builds never block on the descriptor: they check it once, then
+ *	advance the simulated clock to the deadline.
+ *
+ *	Input:
+ *		fd: The descriptor to watch, or -1 to wait for the deadline alone.
+ *		deadline: The time to give up, on the get_monotonic_ns clock.
+ *
+ *	Output: Returns true if and only if fd has input to read.
+ */
+bool timer_wait_fd( int fd, timer_ns deadline );
+
+/**
+ *	scheduler_init:
+ *
+ *	Sets up a scheduler for ticks of a fixed length, the first falling due
+ *	one tick after the current frame time.
+ *
+ *	Deadlines advance by exactly one tick each time, not from the time a
+ *	tick happened to run, so the tick rate does not drift under load.
+ *	After a stall, the ticks that fell due are run together, up to
+ *	max_catch_up of them; any more are dropped.
+ *
+ *	Input:
+ *		scheduler: The scheduler to set up.
+ *		milliseconds: The length of a tick.
+ *		max_catch_up: The most ticks to run at once. At least 1.
+ *
+ *	Output: void.
+ */
+void scheduler_init( tick_scheduler * scheduler, long milliseconds, int max_catch_up );
+
+/**
+ *	scheduler_restart:
+ *
+ *	Makes the next tick fall due one tick after the current frame time,
+ *	so that time spent waiting (for example, for a key) is not caught up.
+ *	Statistics are kept.
+ *
+ *	Input:
+ *		scheduler: The scheduler.
+ *
+ *	Output: void.
+ */
+void scheduler_restart( tick_scheduler * scheduler );
+
+/**
+ *	scheduler_ticks_due:
+ *
+ *	Counts the ticks which have fallen due by the current frame time and
+ *	moves the deadline past them. Call once per frame, after
+ *	timer_begin_frame, and run that many ticks.
+ *
+ *	Input:
+ *		scheduler: The scheduler.
+ *
+ *	Output:
+ *		Returns the number of ticks to run, from 0 to max_catch_up.
+ */
+int scheduler_ticks_due( tick_scheduler * scheduler );
+
+/**
+ *	scheduler_sleep:
+ *
+ *	Pauses until the next tick falls due, or for at most max_milliseconds,
+ *	whichever comes first. The limit lets a program keep polling for input
+ *	between widely spaced ticks.
+ *
+ *	Input:
+ *		scheduler: The scheduler.
+ *		max_milliseconds: The longest pause.
+ *
+ *	Output: void.
+ */
+void scheduler_sleep( tick_scheduler * scheduler, long max_milliseconds );
+
+/**
+ *	scheduler_stats:
+ *
+ *	Summarises how late ticks have been run relative to their deadlines.
+ *
+ *	Input:
+ *		scheduler: The scheduler.
+ *
+ *	Output:
+ *		stats: Filled in with the summary. The times are zero if no tick has run.
+ */
+void scheduler_stats( tick_scheduler * scheduler, tick_stats * stats );
+
 #endif
@@ -0,0 +1,178 @@
+/*
+ *	cab202_work_pool.c
+ *
+ *	Work stealing over ranges of items. See cab202_work_pool.h.
+ *
+ *	Each worker owns a range [next, end) of the items not yet taken,
+ *	behind a lock of its own. The owner takes from the front; a thief
+ *	takes the back half and makes it its own range. Ranges only ever
+ *	shrink or move between workers, so once a thief finds every range
+ *	empty, the only items left are those being run or being moved by
+ *	another thief, which that worker will run itself.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "cab202_work_pool.h"
+
+/*
+ *	The items left to a worker. Kept one per cache line, so workers taking
+ *	items do not slow each other down.
+ */
+typedef struct work_range {
+	pthread_mutex_t lock;
+	long next;
+	long end;
+} __attribute__(( aligned( 64 ) )) work_range;
+
+typedef struct work_pool {
+	work_range * ranges;
+	int threads;
+	work_function function;
+	void * context;
+	long steals;
+} work_pool;
+
+typedef struct work_worker {
+	work_pool * pool;
+	int index;
+} work_worker;
+
+int work_pool_threads( void ) {
+	long online = sysconf( _SC_NPROCESSORS_ONLN );
+	return online > 0 ? (int) online : 1;
+}
+
+/*
+ *	Takes the next item of a range. Returns false if the range is empty.
+ */
+static bool take_item( work_range * range, long * item ) {
+	pthread_mutex_lock( &range->lock );
+	bool taken = range->next < range->end;
+
+	if ( taken ) {
+		*item = range->next++;
+	}
+
+	pthread_mutex_unlock( &range->lock );
+	return taken;
+}
+
+/*
+ *	Moves the back half of the largest range of another worker to that of
+ *	worker thief. Returns false if every other range is empty.
+ */
+static bool steal_items( work_pool * pool, int thief ) {
+	for ( ;; ) {
+		int victim = -1;
+		long most = 0;
+
+		for ( int i = 0; i < pool->threads; i++ ) {
+			if ( i == thief ) continue;
+
+			work_range * range = &pool->ranges[i];
+			pthread_mutex_lock( &range->lock );
+			long left = range->end - range->next;
+			pthread_mutex_unlock( &range->lock );
+
+			if ( left > most ) {
+				victim = i;
+				most = left;
+			}
+		}
+
+		if ( victim < 0 ) return false;
+
+		work_range * range = &pool->ranges[victim];
+		pthread_mutex_lock( &range->lock );
+		long left = range->end - range->next;
+		long half = ( left + 1 ) / 2;
+		long start = range->end - half;
+		range->end = start;
+		pthread_mutex_unlock( &range->lock );
+
+		if ( half > 0 ) {
+			work_range * own = &pool->ranges[thief];
+			pthread_mutex_lock( &own->lock );
+			own->next = start;
+			own->end = start + half;
+			pthread_mutex_unlock( &own->lock );
+			__atomic_add_fetch( &pool->steals, 1, __ATOMIC_RELAXED );
+			return true;
+		}
+
+		// The victim ran dry while it was chosen; look again.
+	}
+}
+
+static void * work_pool_worker( void * argument ) {
+	work_worker * worker = argument;
+	work_pool * pool = worker->pool;
+	work_range * own = &pool->ranges[worker->index];
+	long item;
+
+	do {
+		while ( take_item( own, &item ) ) {
+			pool->function( pool->context, item, worker->index );
+		}
+	} while ( steal_items( pool, worker->index ) );
+
+	return NULL;
+}
+
+bool work_pool_run( long count, int threads, work_function function, void * context, long * steals ) {
+	assert( threads >= 1 && function != NULL );
+
+	work_pool pool = { NULL, threads, function, context, 0 };
+	if ( posix_memalign( (void **) &pool.ranges, sizeof( work_range ), threads * sizeof( work_range ) ) != 0 ) {
+		pool.ranges = NULL;
+	}
+
+	work_worker * workers = malloc( threads * sizeof( work_worker ) );
+	pthread_t * handles = malloc( threads * sizeof( pthread_t ) );
+	bool started = pool.ranges != NULL && workers != NULL && handles != NULL;
+
+	if ( !started ) {
+		// Runs everything on the calling thread.
+		for ( long item = 0; item < count; item++ ) {
+			function( context, item, 0 );
+		}
+	} else {
+		for ( int i = 0; i < threads; i++ ) {
+			pthread_mutex_init( &pool.ranges[i].lock, NULL );
+			pool.ranges[i].next = count * i / threads;
+			pool.ranges[i].end = count * ( i + 1 ) / threads;
+			workers[i] = (work_worker) { &pool, i };
+		}
+
+		int running = 1;
+
+		for ( ; running < threads; running++ ) {
+			if ( pthread_create( &handles[running], NULL, work_pool_worker, &workers[running] ) != 0 ) {
+				started = false; // the workers running steal the items of the others
+				break;
+			}
+		}
+
+		work_pool_worker( &workers[0] );
+
+		for ( int i = 1; i < running; i++ ) {
+			pthread_join( handles[i], NULL );
+		}
+
+		for ( int i = 0; i < threads; i++ ) {
+			pthread_mutex_destroy( &pool.ranges[i].lock );
+		}
+	}
+
+	if ( steals != NULL ) {
+		*steals = pool.steals;
+	}
+
+	free( pool.ranges );
+	free( workers );
+	free( handles );
+	return started;
+}
@@ -0,0 +1,64 @@
+/*
+ *	cab202_work_pool.h
+ *
+ *	Runs a batch of independent work items on several threads at once,
+ *	for programs which repeat a computation many times over, such as
+ *	simulating many game sessions.
+ *
+ *	Items are numbered from 0. Each thread starts with an equal share of
+ *	the numbers, as a range, and takes items one at a time from the front
+ *	of its own range. A thread whose range has run out steals the back
+ *	half of the largest range left to another thread, so items which take
+ *	uneven time still keep every thread busy, and threads only contend
+ *	when one of them runs dry.
+ *
+ *	Items run in no particular order and on no particular thread, so the
+ *	result of an item must depend only on its number. A thread is given
+ *	its worker number, from 0, so it can keep its own scratch state and
+ *	totals without locking.
+ */
+
+#ifndef __CAB202_WORK_POOL_H__
+#define __CAB202_WORK_POOL_H__
+
+#include <stdbool.h>
+
+/*
+ *	Function called to run one item.
+ *
+ *	Input:
+ *		context: The pointer given to work_pool_run.
+ *		item: The number of the item, from 0 to count - 1.
+ *		worker: The number of the worker running it, from 0 to threads - 1.
+ */
+typedef void ( * work_function )( void * context, long item, int worker );
+
+/*
+ *	work_pool_threads:
+ *
+ *	Output:
+ *		Returns the number of processors online, and at least 1.
+ */
+int work_pool_threads( void );
+
+/*
+ *	work_pool_run:
+ *
+ *	Runs items 0 to count - 1 on threads workers, and returns when all of
+ *	them have run. Worker 0 is the calling thread.
+ *
+ *	Input:
+ *		count: The number of items.
+ *		threads: The number of workers, at least 1.
+ *		function: The function run for each item.
+ *		context: Passed to function.
+ *		steals: If not NULL, receives the number of times a worker stole
+ *			items from another.
+ *
+ *	Output:
+ *		Returns false if the threads could not be started. Items may then
+ *		have run on fewer workers, but every item has still run once.
+ */
+bool work_pool_run( long count, int threads, work_function function, void * context, long * steals );
+
+#endif
@@ -0,0 +1,599 @@
+/*
+ *	zdk_view.c
+ *
+ *	Viewer for screen captures written by the ZDK graphics library. It
+ *	understands both the text format written by save_screen and save_char
+ *	(zdk_screen.txt) and the binary delta format described in
+ *	cab202_capture.h.
+ *
+ *	The capture is memory-mapped rather than read, and a frame index is
+ *	built on first use and cached beside the capture as FILE.idx. Any frame
+ *	can then be reached in constant time: by number through the index, and
+ *	by timestamp through a table of time buckets. A binary frame is decoded
+ *	from its keyframe, so at most one keyframe interval of deltas is applied.
+ *
+ *	Usage:
+ *		zdk_view FILE					interactive playback
+ *		zdk_view FILE --info			print a summary of the capture
+ *		zdk_view FILE --frame N			print frame N (the first frame is 1)
+ *		zdk_view FILE --time T			print the frame on screen T seconds in
+ *
+ *	Playback keys:
+ *		space		pause or resume
+ *		+ / -		double or halve the playback speed (1x to 100x)
+ *		left/right	step one frame back or forward, and pause
+ *		up/down		jump 10 seconds forward or back
+ *		home/end	jump to the first or last frame
+ *		q			quit
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <curses.h>
+#include "cab202_graphics.h"
+#include "cab202_timers.h"
+#include "cab202_capture.h"
+
+#define INDEX_MAGIC "ZDKIDX2\n" // version 1 indexed records too short for their contents
+#define FORMAT_TEXT 1
+#define FORMAT_BINARY 2
+#define MIN_SPEED 1.0
+#define MAX_SPEED 100.0
+
+/*
+ *	Location of one frame in the capture.
+ */
+typedef struct Frame_Entry {
+	uint64_t offset;		// start of the frame's record (binary) or its cells (text)
+	double time;			// timestamp stored with the frame
+	uint32_t keyframe;		// frame to start decoding from
+	uint16_t width;
+	uint16_t height;
+} Frame_Entry;
+
+/*
+ *	Header of a cached index file. Entries and buckets follow it.
+ */
+typedef struct Index_Header {
+	char magic[8];
+	uint64_t source_size;
+	int64_t source_mtime;
+	uint32_t entry_size;
+	uint32_t format;
+	uint32_t frames;
+	uint32_t buckets;
+	double bucket_width;
+} Index_Header;
+
+/*
+ *	An open capture.
+ */
+typedef struct Capture {
+	const unsigned char * data;
+	size_t size;
+	int format;
+	Frame_Entry * frames;
+	uint32_t frame_count;
+	uint32_t * buckets;		// buckets[b] = first frame at or after start + b * bucket_width
+	uint32_t bucket_count;
+	double bucket_width;
+	char * cells;			// the decoded frame
+	uint32_t decoded;		// number of the frame in cells, or frame_count if none
+} Capture;
+
+static uint32_t get_u16( const unsigned char * p ) {
+	return p[0] | ( p[1] << 8 );
+}
+
+static uint32_t get_u32( const unsigned char * p ) {
+	return get_u16( p ) | ( get_u16( p + 2 ) << 16 );
+}
+
+static double get_f64( const unsigned char * p ) {
+	uint64_t bits = get_u32( p ) | ( (uint64_t) get_u32( p + 4 ) << 32 );
+	double value;
+	memcpy( &value, &bits, sizeof( value ) );
+	return value;
+}
+
+/*
+ *	Reads an unsigned LEB128 varint, advancing *p.
+ */
+static uint32_t get_varint( const unsigned char ** p, const unsigned char * end ) {
+	uint32_t value = 0;
+
+	for ( int shift = 0; *p < end && shift < 35; shift += 7 ) {
+		unsigned char byte = *( *p )++;
+		value |= (uint32_t) ( byte & 0x7f ) << shift;
+		if ( byte < 0x80 ) break;
+	}
+
+	return value;
+}
+
+/*
+ *	Appends an entry to the frame index.
+ */
+static void add_frame( Capture * capture, uint32_t * capacity, Frame_Entry * entry ) {
+	if ( capture->frame_count >= *capacity ) {
+		*capacity = *capacity == 0 ? 1024 : *capacity * 2;
+		capture->frames = realloc( capture->frames, *capacity * sizeof( Frame_Entry ) );
+	}
+
+	capture->frames[capture->frame_count++] = *entry;
+}
+
+/*
+ *	Indexes a binary capture by walking its record headers. Records too short
+ *	for their contents (a keyframe's 16 byte header and cells, or a delta's 12
+ *	byte header) are skipped, with the deltas after a skipped keyframe.
+ */
+static void index_binary( Capture * capture ) {
+	const unsigned char * data = capture->data;
+	size_t pos = CAPTURE_HEADER_SIZE;
+	uint32_t capacity = 0;
+	uint32_t keyframe = 0;
+	uint16_t width = get_u16( data + 8 );
+	uint16_t height = get_u16( data + 10 );
+	bool have_keyframe = false;
+
+	while ( pos + CAPTURE_RECORD_HEADER_SIZE <= capture->size ) {
+		int tag = data[pos];
+		uint32_t size = get_u32( data + pos + 1 );
+		const unsigned char * payload = data + pos + CAPTURE_RECORD_HEADER_SIZE;
+
+		if ( pos + CAPTURE_RECORD_HEADER_SIZE + size > capture->size ) break;
+
+		if ( tag == CAPTURE_KEYFRAME ) {
+			have_keyframe = size >= 16 && size >= 16 + (uint32_t) get_u16( payload + 12 ) * get_u16( payload + 14 );
+		}
+
+		if ( ( tag == CAPTURE_KEYFRAME || tag == CAPTURE_DELTA ) && have_keyframe && size >= 12 ) {
+			Frame_Entry entry;
+
+			if ( tag == CAPTURE_KEYFRAME ) {
+				keyframe = capture->frame_count;
+				width = get_u16( payload + 12 );
+				height = get_u16( payload + 14 );
+			}
+
+			entry.offset = pos;
+			entry.time = get_f64( payload );
+			entry.keyframe = keyframe;
+			entry.width = width;
+			entry.height = height;
+			add_frame( capture, &capacity, &entry );
+		}
+
+		pos += CAPTURE_RECORD_HEADER_SIZE + size;
+	}
+}
+
+/*
+ *	Indexes a text capture by scanning for Frame(...) lines.
+ */
+static void index_text( Capture * capture ) {
+	const char * data = (const char *) capture->data;
+	const char * end = data + capture->size;
+	const char * line = data;
+	uint32_t capacity = 0;
+
+	while ( line < end ) {
+		const char * next = memchr( line, '\n', end - line );
+		next = next == NULL ? end : next + 1;
+
+		int width, height;
+		double time;
+
+		if ( end - line > 6 && memcmp( line, "Frame(", 6 ) == 0
+			&& sscanf( line, "Frame(%d,%d,%lf)", &width, &height, &time ) == 3
+			&& width > 0 && height > 0
+			&& (size_t) ( end - next ) >= (size_t) height * ( width + 1 ) ) {
+			Frame_Entry entry;
+			entry.offset = next - data;
+			entry.time = time;
+			entry.keyframe = capture->frame_count;
+			entry.width = width;
+			entry.height = height;
+			add_frame( capture, &capacity, &entry );
+			next += (size_t) height * ( width + 1 );
+		}
+
+		line = next;
+	}
+}
+
+/*
+ *	Builds the table which maps a timestamp to a frame in constant time.
+ *	Bucket widths are chosen so that there is about one frame per bucket.
+ */
+static void build_buckets( Capture * capture ) {
+	uint32_t n = capture->frame_count;
+	double start = capture->frames[0].time;
+	double duration = capture->frames[n - 1].time - start;
+
+	capture->bucket_count = n + 1;
+	capture->bucket_width = duration > 0 ? duration / n : 1;
+	capture->buckets = malloc( capture->bucket_count * sizeof( uint32_t ) );
+
+	uint32_t frame = 0;
+
+	for ( uint32_t b = 0; b < capture->bucket_count; b++ ) {
+		double bucket_start = start + b * capture->bucket_width;
+		while ( frame < n && capture->frames[frame].time < bucket_start ) frame++;
+		capture->buckets[b] = frame;
+	}
+}
+
+/*
+ *	Loads a cached index, if it exists and matches the capture.
+ */
+static bool load_index( Capture * capture, const char * index_name, struct stat * source ) {
+	FILE * f = fopen( index_name, "rb" );
+
+	if ( f == NULL ) return false;
+
+	Index_Header header;
+	bool ok = fread( &header, sizeof( header ), 1, f ) == 1
+		&& memcmp( header.magic, INDEX_MAGIC, 8 ) == 0
+		&& header.source_size == (uint64_t) source->st_size
+		&& header.source_mtime == (int64_t) source->st_mtime
+		&& header.entry_size == sizeof( Frame_Entry )
+		&& header.frames > 0;
+
+	if ( ok ) {
+		capture->format = header.format;
+		capture->frame_count = header.frames;
+		capture->bucket_count = header.buckets;
+		capture->bucket_width = header.bucket_width;
+		capture->frames = malloc( header.frames * sizeof( Frame_Entry ) );
+		capture->buckets = malloc( header.buckets * sizeof( uint32_t ) );
+		ok = fread( capture->frames, sizeof( Frame_Entry ), header.frames, f ) == header.frames
+			&& fread( capture->buckets, sizeof( uint32_t ), header.buckets, f ) == header.buckets;
+
+		if ( !ok ) {
+			free( capture->frames );
+			free( capture->buckets );
+			capture->frames = NULL;
+			capture->buckets = NULL;
+			capture->frame_count = 0;
+		}
+	}
+
+	fclose( f );
+	return ok;
+}
+
+/*
+ *	Saves the index beside the capture, so that it need not be rebuilt.
+ */
+static void save_index( Capture * capture, const char * index_name, struct stat * source ) {
+	FILE * f = fopen( index_name, "wb" );
+
+	if ( f == NULL ) return;
+
+	Index_Header header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, INDEX_MAGIC, 8 );
+	header.source_size = source->st_size;
+	header.source_mtime = source->st_mtime;
+	header.entry_size = sizeof( Frame_Entry );
+	header.format = capture->format;
+	header.frames = capture->frame_count;
+	header.buckets = capture->bucket_count;
+	header.bucket_width = capture->bucket_width;
+
+	fwrite( &header, sizeof( header ), 1, f );
+	fwrite( capture->frames, sizeof( Frame_Entry ), capture->frame_count, f );
+	fwrite( capture->buckets, sizeof( uint32_t ), capture->bucket_count, f );
+	fclose( f );
+}
+
+/*
+ *	Maps a capture into memory and loads or builds its index.
+ */
+static bool open_capture( Capture * capture, const char * file_name ) {
+	memset( capture, 0, sizeof( *capture ) );
+
+	int fd = open( file_name, O_RDONLY );
+	struct stat source;
+
+	if ( fd < 0 || fstat( fd, &source ) != 0 || source.st_size == 0 ) {
+		if ( fd >= 0 ) close( fd );
+		return false;
+	}
+
+	capture->size = source.st_size;
+	capture->data = mmap( NULL, capture->size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+
+	if ( capture->data == MAP_FAILED ) return false;
+
+	char index_name[4096];
+	snprintf( index_name, sizeof( index_name ), "%s.idx", file_name );
+
+	if ( !load_index( capture, index_name, &source ) ) {
+		if ( capture->size >= CAPTURE_HEADER_SIZE && memcmp( capture->data, CAPTURE_MAGIC, 8 ) == 0 ) {
+			capture->format = FORMAT_BINARY;
+			index_binary( capture );
+		}
+		else {
+			capture->format = FORMAT_TEXT;
+			index_text( capture );
+		}
+
+		if ( capture->frame_count == 0 ) return false;
+
+		build_buckets( capture );
+		save_index( capture, index_name, &source );
+	}
+
+	uint32_t largest = 0;
+
+	for ( uint32_t i = 0; i < capture->frame_count; i++ ) {
+		uint32_t cells = capture->frames[i].width * capture->frames[i].height;
+		if ( cells > largest ) largest = cells;
+	}
+
+	capture->cells = malloc( largest );
+	capture->decoded = capture->frame_count;
+	return true;
+}
+
+/*
+ *	Applies the delta record for a frame to the decoded cells.
+ */
+static void apply_delta( Capture * capture, Frame_Entry * entry ) {
+	const unsigned char * record = capture->data + entry->offset;
+	const unsigned char * end = record + CAPTURE_RECORD_HEADER_SIZE + get_u32( record + 1 );
+	const unsigned char * p = record + CAPTURE_RECORD_HEADER_SIZE + 12;
+	uint32_t size = entry->width * entry->height;
+	uint32_t runs = get_varint( &p, end );
+	uint32_t cell = 0;
+
+	for ( uint32_t i = 0; i < runs && p < end; i++ ) {
+		cell += get_varint( &p, end );
+		uint32_t length = get_varint( &p, end );
+
+		if ( cell + length > size || p + length > end ) return;
+
+		memcpy( capture->cells + cell, p, length );
+		p += length;
+		cell += length;
+	}
+}
+
+/*
+ *	Decodes a frame into capture->cells. Continues from the frame already
+ *	decoded when possible; otherwise starts from the frame's keyframe.
+ */
+static void decode_frame( Capture * capture, uint32_t frame ) {
+	if ( frame == capture->decoded ) return;
+
+	Frame_Entry * entry = &capture->frames[frame];
+
+	if ( capture->format == FORMAT_TEXT ) {
+		const unsigned char * row = capture->data + entry->offset;
+
+		for ( int y = 0; y < entry->height; y++, row += entry->width + 1 ) {
+			memcpy( capture->cells + y * entry->width, row, entry->width );
+		}
+
+		capture->decoded = frame;
+		return;
+	}
+
+	uint32_t next = entry->keyframe;
+
+	if ( capture->decoded < frame && capture->frames[capture->decoded].keyframe == entry->keyframe ) {
+		next = capture->decoded + 1;
+	}
+	else {
+		Frame_Entry * key = &capture->frames[entry->keyframe];
+		const unsigned char * payload = capture->data + key->offset + CAPTURE_RECORD_HEADER_SIZE;
+		memcpy( capture->cells, payload + 16, key->width * key->height );
+		next = entry->keyframe + 1;
+	}
+
+	for ( ; next <= frame; next++ ) {
+		apply_delta( capture, &capture->frames[next] );
+	}
+
+	capture->decoded = frame;
+}
+
+/*
+ *	Returns the frame on screen at a given time since the start of the capture.
+ */
+static uint32_t frame_at( Capture * capture, double seconds ) {
+	double t = capture->frames[0].time + seconds;
+	double b = seconds / capture->bucket_width;
+
+	if ( b < 0 ) b = 0;
+	if ( b > capture->bucket_count - 1 ) b = capture->bucket_count - 1;
+
+	uint32_t frame = capture->buckets[(uint32_t) b];
+
+	if ( frame >= capture->frame_count ) frame = capture->frame_count - 1;
+
+	while ( frame + 1 < capture->frame_count && capture->frames[frame + 1].time <= t ) frame++;
+	while ( frame > 0 && capture->frames[frame].time > t ) frame--;
+
+	return frame;
+}
+
+/*
+ *	Writes a decoded frame to standard output.
+ */
+static void print_frame( Capture * capture, uint32_t frame ) {
+	decode_frame( capture, frame );
+	Frame_Entry * entry = &capture->frames[frame];
+
+	for ( int y = 0; y < entry->height; y++ ) {
+		fwrite( capture->cells + y * entry->width, 1, entry->width, stdout );
+		putchar( '\n' );
+	}
+}
+
+/*
+ *	Writes a summary of the capture to standard output.
+ */
+static void print_info( Capture * capture ) {
+	uint32_t keyframes = 0;
+
+	for ( uint32_t i = 0; i < capture->frame_count; i++ ) {
+		if ( capture->frames[i].keyframe == i ) keyframes++;
+	}
+
+	printf( "format: %s\n", capture->format == FORMAT_BINARY ? "binary" : "text" );
+	printf( "size: %zu bytes\n", capture->size );
+	printf( "frames: %u\n", capture->frame_count );
+	printf( "keyframes: %u\n", keyframes );
+	printf( "duration: %.3f s\n", capture->frames[capture->frame_count - 1].time - capture->frames[0].time );
+	printf( "screen: %ux%u\n", capture->frames[0].width, capture->frames[0].height );
+}
+
+/*
+ *	Displays a frame with a status line.
+ */
+static void show_frame( Capture * capture, uint32_t frame, double speed, bool paused ) {
+	decode_frame( capture, frame );
+	Frame_Entry * entry = &capture->frames[frame];
+
+	clear_screen();
+
+	for ( int y = 0; y < entry->height; y++ ) {
+		draw_chars( 0, y, capture->cells + y * entry->width, entry->width );
+	}
+
+	int status_row = entry->height < screen_height() ? entry->height : screen_height() - 1;
+	draw_hline( 0, screen_width() - 1, status_row, ' ' );
+	draw_formatted( 0, status_row, "frame %u/%u  t=%.2fs  %gx%s",
+		frame + 1, capture->frame_count, entry->time - capture->frames[0].time,
+		speed, paused ? "  [paused]" : "" );
+	show_screen();
+}
+
+/*
+ *	Interactive playback.
+ */
+static void play( Capture * capture ) {
+	double duration = capture->frames[capture->frame_count - 1].time - capture->frames[0].time;
+	double position = 0;	// seconds into the capture
+	double speed = MIN_SPEED;
+	bool paused = false;
+	uint32_t frame = 0;
+	uint32_t shown = capture->frame_count;
+
+	setup_screen();
+
+	double last = get_current_time();
+
+	for ( ;; ) {
+		int key = get_char();
+		bool redraw = false;
+
+		if ( key == 'q' ) break;
+
+		switch ( key ) {
+			case ' ':
+				paused = !paused;
+				redraw = true;
+				break;
+			case '+':
+				speed = speed * 2 > MAX_SPEED ? MAX_SPEED : speed * 2;
+				redraw = true;
+				break;
+			case '-':
+				speed = speed / 2 < MIN_SPEED ? MIN_SPEED : speed / 2;
+				redraw = true;
+				break;
+			case KEY_RIGHT:
+			case KEY_LEFT:
+				paused = true;
+				if ( key == KEY_RIGHT && frame + 1 < capture->frame_count ) frame++;
+				if ( key == KEY_LEFT && frame > 0 ) frame--;
+				position = capture->frames[frame].time - capture->frames[0].time;
+				redraw = true;
+				break;
+			case KEY_UP:
+				position += 10;
+				break;
+			case KEY_DOWN:
+				position -= 10;
+				break;
+			case KEY_HOME:
+				position = 0;
+				break;
+			case KEY_END:
+				position = duration;
+				break;
+		}
+
+		double now = get_current_time();
+
+		if ( !paused ) {
+			position += ( now - last ) * speed;
+		}
+
+		last = now;
+
+		if ( position < 0 ) position = 0;
+		if ( position > duration ) position = duration;
+
+		if ( !( paused && ( key == KEY_RIGHT || key == KEY_LEFT ) ) ) {
+			frame = frame_at( capture, position );
+		}
+
+		if ( frame != shown || redraw ) {
+			show_frame( capture, frame, speed, paused );
+			shown = frame;
+		}
+
+		timer_pause( 10 );
+	}
+
+	cleanup_screen();
+}
+
+int main( int argc, char * argv[] ) {
+	if ( argc < 2 ) {
+		fprintf( stderr, "Usage: %s FILE [--info | --frame N | --time SECONDS]\n", argv[0] );
+		return 1;
+	}
+
+	Capture capture;
+
+	if ( !open_capture( &capture, argv[1] ) ) {
+		fprintf( stderr, "%s: no frames found in %s\n", argv[0], argv[1] );
+		return 1;
+	}
+
+	if ( argc == 2 ) {
+		play( &capture );
+	}
+	else if ( strcmp( argv[2], "--info" ) == 0 ) {
+		print_info( &capture );
+	}
+	else if ( strcmp( argv[2], "--frame" ) == 0 && argc > 3 ) {
+		long frame = atol( argv[3] ) - 1; // numbered from 1, as in the player
+		if ( frame < 0 ) frame = 0;
+		if ( frame >= (long) capture.frame_count ) frame = capture.frame_count - 1;
+		print_frame( &capture, frame );
+	}
+	else if ( strcmp( argv[2], "--time" ) == 0 && argc > 3 ) {
+		print_frame( &capture, frame_at( &capture, atof( argv[3] ) ) );
+	}
+	else {
+		fprintf( stderr, "%s: unknown option %s\n", argv[0], argv[2] );
+		return 1;
+	}
+
+	return 0;
+}